@@ -0,0 +1,90 @@
+/*
+ * Camera frame preprocessing for the skytrack tracker.
+ *
+ * Turns a MIPI CSI-2 RAW10 frame from an RGGB sensor into RGBA8 and a
+ * pyramid of 2x downscaled levels, either on the CPU (NEON on aarch64) or
+ * with Vulkan compute shaders. Both backends compute exactly the same
+ * integer result, so the test can compare them bit for bit and each device
+ * can pick whichever backend the benchmark shows to be faster.
+ */
+
+#ifndef SKYTRACK_VKISP_H
+#define SKYTRACK_VKISP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace skytrack::vkisp {
+
+/* Bytes of one packed RAW10 frame; width must be a multiple of 4. */
+inline size_t raw10_size(uint32_t width, uint32_t height)
+{
+    return static_cast<size_t>(width) / 4 * 5 * height;
+}
+
+/*
+ * Output of one frame: level 0 is full size, each further level half.
+ * Asking for 0 levels gives level 0 only.
+ */
+struct Pyramid {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<std::vector<uint32_t>> levels;
+};
+
+namespace cpu {
+
+/* Portable implementations, the reference for the other backends. */
+void unpack_raw10_scalar(const uint8_t *raw, uint16_t *bayer, uint32_t width, uint32_t height);
+void downscale_scalar(const uint32_t *in, uint32_t *out, uint32_t width, uint32_t height);
+
+/* Fastest CPU implementation for the build target, NEON on aarch64. */
+void unpack_raw10(const uint8_t *raw, uint16_t *bayer, uint32_t width, uint32_t height);
+void debayer_rggb(const uint16_t *bayer, uint32_t *rgba, uint32_t width, uint32_t height);
+void downscale(const uint32_t *in, uint32_t *out, uint32_t width, uint32_t height);
+
+void process(const uint8_t *raw, uint32_t width, uint32_t height, unsigned levels, Pyramid &out);
+
+} // namespace cpu
+
+/*
+ * Vulkan compute backend.
+ *
+ * Frames are queued into a ring of slots, each with its own buffers,
+ * command buffer and fence, so the caller can capture the next frame while
+ * the GPU still works on the previous ones. submit() only waits when the
+ * slot it reuses is still in flight.
+ */
+class Gpu {
+public:
+    /*
+     * device selects the first physical device whose name contains it,
+     * e.g. "llvmpipe" for Mesa lavapipe; empty picks the first device with
+     * a compute queue. Throws std::runtime_error on failure.
+     */
+    Gpu(uint32_t width, uint32_t height, unsigned levels, const std::string &device = "",
+        unsigned slots = 2);
+    ~Gpu();
+
+    Gpu(const Gpu &) = delete;
+    Gpu &operator=(const Gpu &) = delete;
+
+    const std::string &device_name() const;
+
+    /* Queue a RAW10 frame, returns the slot it runs in. */
+    unsigned submit(const uint8_t *raw);
+
+    /* Wait for the frame in a slot and copy its pyramid out. */
+    void wait(unsigned slot, Pyramid &out);
+
+private:
+    struct State;
+    std::unique_ptr<State> state_;
+};
+
+} // namespace skytrack::vkisp
+
+#endif
@@ -0,0 +1,203 @@
+/*
+ * CPU backend. The scalar functions define the exact result every backend
+ * has to produce; the NEON versions only change how it is computed.
+ */
+
+#include "skytrack/vkisp.h"
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define SKYTRACK_VKISP_NEON 1
+#endif
+
+namespace skytrack::vkisp::cpu {
+
+namespace {
+
+/*
+ * RAW10: every 4 pixels are packed into 5 bytes, the high 8 bits of each
+ * pixel followed by a byte holding the low 2 bits of all four.
+ */
+inline void unpack_group(const uint8_t *src, uint16_t *dst)
+{
+    uint8_t low = src[4];
+    for (int j = 0; j < 4; j++)
+        dst[j] = static_cast<uint16_t>(src[j] << 2 | (low >> (2 * j) & 3));
+}
+
+/* Per channel rounded average of a 2x2 block of RGBA8 pixels. */
+inline uint32_t average4(uint32_t a, uint32_t b, uint32_t c, uint32_t d)
+{
+    uint32_t v = 0;
+    for (int s = 0; s < 32; s += 8) {
+        uint32_t sum = (a >> s & 0xff) + (b >> s & 0xff) + (c >> s & 0xff) + (d >> s & 0xff);
+        v |= ((sum + 2) >> 2) << s;
+    }
+    return v;
+}
+
+inline uint32_t mirror(int64_t v, uint32_t n)
+{
+    if (v < 0)
+        return static_cast<uint32_t>(-v);
+    if (v >= n)
+        return static_cast<uint32_t>(2 * int64_t(n) - 2 - v);
+    return static_cast<uint32_t>(v);
+}
+
+inline uint32_t rgba(uint32_t r, uint32_t g, uint32_t b)
+{
+    return r >> 2 | (g >> 2) << 8 | (b >> 2) << 16 | 0xff000000u;
+}
+
+/*
+ * Bilinear RGGB demosaic of one pixel given its row and the rows above and
+ * below, with columns mirrored at the edges.
+ */
+inline uint32_t demosaic(const uint16_t *up, const uint16_t *row, const uint16_t *down,
+                         uint32_t x, uint32_t y, uint32_t width)
+{
+    uint32_t l = mirror(int64_t(x) - 1, width);
+    uint32_t r = mirror(int64_t(x) + 1, width);
+    uint32_t c = row[x];
+    uint32_t horiz = row[l] + row[r];
+    uint32_t vert = up[x] + down[x];
+    uint32_t ortho = (horiz + vert + 2) >> 2;
+    uint32_t diag = (up[l] + up[r] + down[l] + down[r] + 2) >> 2;
+
+    if (!(y & 1))
+        return x & 1 ? rgba((horiz + 1) >> 1, c, (vert + 1) >> 1) : rgba(c, ortho, diag);
+    return x & 1 ? rgba(diag, ortho, c) : rgba((vert + 1) >> 1, c, (horiz + 1) >> 1);
+}
+
+} // namespace
+
+void unpack_raw10_scalar(const uint8_t *raw, uint16_t *bayer, uint32_t width, uint32_t height)
+{
+    size_t groups = static_cast<size_t>(width) / 4 * height;
+    for (size_t g = 0; g < groups; g++)
+        unpack_group(raw + 5 * g, bayer + 4 * g);
+}
+
+void downscale_scalar(const uint32_t *in, uint32_t *out, uint32_t width, uint32_t height)
+{
+    uint32_t ow = width / 2, oh = height / 2;
+    for (uint32_t y = 0; y < oh; y++) {
+        const uint32_t *r0 = in + size_t(2 * y) * width;
+        const uint32_t *r1 = r0 + width;
+        for (uint32_t x = 0; x < ow; x++)
+            out[size_t(y) * ow + x] = average4(r0[2 * x], r0[2 * x + 1], r1[2 * x], r1[2 * x + 1]);
+    }
+}
+
+#ifdef SKYTRACK_VKISP_NEON
+
+void unpack_raw10(const uint8_t *raw, uint16_t *bayer, uint32_t width, uint32_t height)
+{
+    /*
+     * 16 pixels come from 20 bytes, loaded as bytes 0-15 and 4-19 so no
+     * load reaches past the group. Table indices 16-31 address the second
+     * load, i.e. byte 4 + (index - 16).
+     */
+    static const uint8_t high_index[16] = {
+        0, 1, 2, 3, 5, 6, 7, 8, 10, 11, 12, 13, 15, 28, 29, 30,
+    };
+    static const uint8_t low_index[16] = {
+        4, 4, 4, 4, 9, 9, 9, 9, 14, 14, 14, 14, 31, 31, 31, 31,
+    };
+    static const int8_t low_shift[16] = {
+        0, -2, -4, -6, 0, -2, -4, -6, 0, -2, -4, -6, 0, -2, -4, -6,
+    };
+    const uint8x16_t hi_idx = vld1q_u8(high_index);
+    const uint8x16_t lo_idx = vld1q_u8(low_index);
+    const int8x16_t shift = vld1q_s8(low_shift);
+    const uint8x16_t three = vdupq_n_u8(3);
+    size_t stride = static_cast<size_t>(width) / 4 * 5;
+
+    for (uint32_t y = 0; y < height; y++) {
+        const uint8_t *src = raw + y * stride;
+        uint16_t *dst = bayer + size_t(y) * width;
+        uint32_t x = 0;
+        for (; x + 16 <= width; x += 16, src += 20, dst += 16) {
+            uint8x16x2_t table = { { vld1q_u8(src), vld1q_u8(src + 4) } };
+            uint8x16_t high = vqtbl2q_u8(table, hi_idx);
+            uint8x16_t low = vandq_u8(vshlq_u8(vqtbl2q_u8(table, lo_idx), shift), three);
+            vst1q_u16(dst, vorrq_u16(vshll_n_u8(vget_low_u8(high), 2), vmovl_u8(vget_low_u8(low))));
+            vst1q_u16(dst + 8, vorrq_u16(vshll_n_u8(vget_high_u8(high), 2), vmovl_u8(vget_high_u8(low))));
+        }
+        for (; x < width; x += 4, src += 5, dst += 4)
+            unpack_group(src, dst);
+    }
+}
+
+void downscale(const uint32_t *in, uint32_t *out, uint32_t width, uint32_t height)
+{
+    uint32_t ow = width / 2, oh = height / 2;
+    for (uint32_t y = 0; y < oh; y++) {
+        const uint32_t *r0 = in + size_t(2 * y) * width;
+        const uint32_t *r1 = r0 + width;
+        uint32_t *dst = out + size_t(y) * ow;
+        uint32_t x = 0;
+        /* vld2 splits even and odd pixels, so lane-wise adds sum each 2x2 block. */
+        for (; x + 4 <= ow; x += 4) {
+            uint32x4x2_t a = vld2q_u32(r0 + 2 * x);
+            uint32x4x2_t b = vld2q_u32(r1 + 2 * x);
+            uint8x16_t ae = vreinterpretq_u8_u32(a.val[0]), ao = vreinterpretq_u8_u32(a.val[1]);
+            uint8x16_t be = vreinterpretq_u8_u32(b.val[0]), bo = vreinterpretq_u8_u32(b.val[1]);
+            uint16x8_t lo = vaddq_u16(vaddl_u8(vget_low_u8(ae), vget_low_u8(ao)),
+                                      vaddl_u8(vget_low_u8(be), vget_low_u8(bo)));
+            uint16x8_t hi = vaddq_u16(vaddl_u8(vget_high_u8(ae), vget_high_u8(ao)),
+                                      vaddl_u8(vget_high_u8(be), vget_high_u8(bo)));
+            vst1q_u8(reinterpret_cast<uint8_t *>(dst + x),
+                     vcombine_u8(vrshrn_n_u16(lo, 2), vrshrn_n_u16(hi, 2)));
+        }
+        for (; x < ow; x++)
+            dst[x] = average4(r0[2 * x], r0[2 * x + 1], r1[2 * x], r1[2 * x + 1]);
+    }
+}
+
+#else
+
+void unpack_raw10(const uint8_t *raw, uint16_t *bayer, uint32_t width, uint32_t height)
+{
+    unpack_raw10_scalar(raw, bayer, width, height);
+}
+
+void downscale(const uint32_t *in, uint32_t *out, uint32_t width, uint32_t height)
+{
+    downscale_scalar(in, out, width, height);
+}
+
+#endif
+
+void debayer_rggb(const uint16_t *bayer, uint32_t *out, uint32_t width, uint32_t height)
+{
+    for (uint32_t y = 0; y < height; y++) {
+        const uint16_t *up = bayer + size_t(mirror(int64_t(y) - 1, height)) * width;
+        const uint16_t *row = bayer + size_t(y) * width;
+        const uint16_t *down = bayer + size_t(mirror(int64_t(y) + 1, height)) * width;
+        for (uint32_t x = 0; x < width; x++)
+            out[size_t(y) * width + x] = demosaic(up, row, down, x, y, width);
+    }
+}
+
+void process(const uint8_t *raw, uint32_t width, uint32_t height, unsigned levels, Pyramid &out)
+{
+    std::vector<uint16_t> bayer(size_t(width) * height);
+
+    /* Like the GPU backend, always produce at least the full size level. */
+    levels = levels ? levels : 1;
+    out.width = width;
+    out.height = height;
+    out.levels.resize(levels);
+    unpack_raw10(raw, bayer.data(), width, height);
+    out.levels[0].resize(size_t(width) * height);
+    debayer_rggb(bayer.data(), out.levels[0].data(), width, height);
+    for (unsigned l = 1; l < levels; l++) {
+        uint32_t w = width >> (l - 1), h = height >> (l - 1);
+        out.levels[l].resize(size_t(w / 2) * (h / 2));
+        downscale(out.levels[l - 1].data(), out.levels[l].data(), w, h);
+    }
+}
+
+} // namespace skytrack::vkisp::cpu
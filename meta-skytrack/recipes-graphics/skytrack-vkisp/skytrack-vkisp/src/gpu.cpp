@@ -0,0 +1,443 @@
+/*
+ * Vulkan compute backend: one dispatch to unpack RAW10, one to demosaic
+ * and one per pyramid level, recorded once per slot and resubmitted for
+ * every frame. All buffers are host visible; on the Jetson and the Pi the
+ * GPU shares system memory, so there is no staging copy.
+ */
+
+#include "skytrack/vkisp.h"
+
+#include <vulkan/vulkan.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+#include "debayer.h"
+#include "downscale.h"
+#include "raw10_unpack.h"
+
+namespace skytrack::vkisp {
+
+namespace {
+
+void check(VkResult result, const char *what)
+{
+    if (result != VK_SUCCESS)
+        throw std::runtime_error(std::string(what) + " failed: " + std::to_string(result));
+}
+
+struct PushConstants {
+    uint32_t width;
+    uint32_t height;
+};
+
+/* Invocations per workgroup, as declared by local_size in the shaders. */
+constexpr uint32_t GROUP_X = 16;
+constexpr uint32_t GROUP_Y = 4;
+
+uint32_t groups(uint32_t n, uint32_t size)
+{
+    return (n + size - 1) / size;
+}
+
+struct Buffer {
+    VkBuffer buffer = VK_NULL_HANDLE;
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize size = 0;
+    void *map = nullptr;
+};
+
+/* One dispatch: its pipeline, the two buffers it binds and its grid. */
+struct Pass {
+    VkPipeline pipeline;
+    VkDescriptorSet set;
+    PushConstants size;
+    uint32_t groups_x;
+    uint32_t groups_y;
+};
+
+struct Slot {
+    Buffer raw;
+    Buffer bayer;
+    std::vector<Buffer> levels;
+    std::vector<Pass> passes;
+    VkCommandBuffer cmd = VK_NULL_HANDLE;
+    VkFence fence = VK_NULL_HANDLE;
+    bool busy = false;
+};
+
+} // namespace
+
+struct Gpu::State {
+    uint32_t width;
+    uint32_t height;
+    unsigned levels;
+    std::string name;
+
+    VkInstance instance = VK_NULL_HANDLE;
+    VkPhysicalDevice physical = VK_NULL_HANDLE;
+    VkDevice device = VK_NULL_HANDLE;
+    VkQueue queue = VK_NULL_HANDLE;
+    uint32_t family = 0;
+    VkPhysicalDeviceMemoryProperties memory_props{};
+
+    VkDescriptorSetLayout set_layout = VK_NULL_HANDLE;
+    VkPipelineLayout layout = VK_NULL_HANDLE;
+    VkPipeline unpack = VK_NULL_HANDLE;
+    VkPipeline debayer = VK_NULL_HANDLE;
+    VkPipeline downscale = VK_NULL_HANDLE;
+    VkDescriptorPool pool = VK_NULL_HANDLE;
+    VkCommandPool commands = VK_NULL_HANDLE;
+
+    std::vector<Slot> slots;
+    unsigned next = 0;
+
+    void create_device(const std::string &filter);
+    VkPipeline create_pipeline(const uint32_t *code, size_t size);
+    Buffer create_buffer(VkDeviceSize size);
+    void destroy_buffer(Buffer &b);
+    VkDescriptorSet create_set(const Buffer &in, const Buffer &out);
+    void record(Slot &slot);
+    ~State();
+};
+
+void Gpu::State::create_device(const std::string &filter)
+{
+    VkApplicationInfo app{VK_STRUCTURE_TYPE_APPLICATION_INFO};
+    app.pApplicationName = "skytrack-vkisp";
+    app.apiVersion = VK_API_VERSION_1_1;
+    VkInstanceCreateInfo instance_info{VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO};
+    instance_info.pApplicationInfo = &app;
+    check(vkCreateInstance(&instance_info, nullptr, &instance), "vkCreateInstance");
+
+    uint32_t count = 0;
+    vkEnumeratePhysicalDevices(instance, &count, nullptr);
+    std::vector<VkPhysicalDevice> devices(count);
+    vkEnumeratePhysicalDevices(instance, &count, devices.data());
+
+    for (VkPhysicalDevice candidate : devices) {
+        VkPhysicalDeviceProperties props;
+        vkGetPhysicalDeviceProperties(candidate, &props);
+        if (!filter.empty() && std::string(props.deviceName).find(filter) == std::string::npos)
+            continue;
+
+        uint32_t nfamilies = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(candidate, &nfamilies, nullptr);
+        std::vector<VkQueueFamilyProperties> families(nfamilies);
+        vkGetPhysicalDeviceQueueFamilyProperties(candidate, &nfamilies, families.data());
+        for (uint32_t i = 0; i < nfamilies; i++) {
+            if (families[i].queueFlags & VK_QUEUE_COMPUTE_BIT) {
+                physical = candidate;
+                family = i;
+                name = props.deviceName;
+                break;
+            }
+        }
+        if (physical)
+            break;
+    }
+    if (!physical)
+        throw std::runtime_error("no Vulkan device with a compute queue" +
+                                 (filter.empty() ? std::string() : " matching \"" + filter + "\""));
+
+    float priority = 1.0f;
+    VkDeviceQueueCreateInfo queue_info{VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO};
+    queue_info.queueFamilyIndex = family;
+    queue_info.queueCount = 1;
+    queue_info.pQueuePriorities = &priority;
+    VkDeviceCreateInfo device_info{VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO};
+    device_info.queueCreateInfoCount = 1;
+    device_info.pQueueCreateInfos = &queue_info;
+    check(vkCreateDevice(physical, &device_info, nullptr, &device), "vkCreateDevice");
+    vkGetDeviceQueue(device, family, 0, &queue);
+    vkGetPhysicalDeviceMemoryProperties(physical, &memory_props);
+}
+
+VkPipeline Gpu::State::create_pipeline(const uint32_t *code, size_t size)
+{
+    VkShaderModuleCreateInfo module_info{VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO};
+    module_info.codeSize = size;
+    module_info.pCode = code;
+    VkShaderModule module;
+    check(vkCreateShaderModule(device, &module_info, nullptr, &module), "vkCreateShaderModule");
+
+    VkComputePipelineCreateInfo info{VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO};
+    info.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    info.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    info.stage.module = module;
+    info.stage.pName = "main";
+    info.layout = layout;
+    VkPipeline pipeline;
+    VkResult result = vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &info, nullptr, &pipeline);
+    vkDestroyShaderModule(device, module, nullptr);
+    check(result, "vkCreateComputePipelines");
+    return pipeline;
+}
+
+Buffer Gpu::State::create_buffer(VkDeviceSize size)
+{
+    Buffer b;
+    b.size = size;
+    VkBufferCreateInfo info{VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO};
+    info.size = size;
+    info.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    check(vkCreateBuffer(device, &info, nullptr, &b.buffer), "vkCreateBuffer");
+
+    VkMemoryRequirements req;
+    vkGetBufferMemoryRequirements(device, b.buffer, &req);
+    const VkMemoryPropertyFlags wanted =
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    uint32_t type = memory_props.memoryTypeCount;
+    for (uint32_t i = 0; i < memory_props.memoryTypeCount; i++) {
+        if ((req.memoryTypeBits & (1u << i)) &&
+            (memory_props.memoryTypes[i].propertyFlags & wanted) == wanted) {
+            type = i;
+            break;
+        }
+    }
+    if (type == memory_props.memoryTypeCount)
+        throw std::runtime_error("no host visible coherent memory type");
+
+    VkMemoryAllocateInfo alloc{VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO};
+    alloc.allocationSize = req.size;
+    alloc.memoryTypeIndex = type;
+    check(vkAllocateMemory(device, &alloc, nullptr, &b.memory), "vkAllocateMemory");
+    check(vkBindBufferMemory(device, b.buffer, b.memory, 0), "vkBindBufferMemory");
+    check(vkMapMemory(device, b.memory, 0, VK_WHOLE_SIZE, 0, &b.map), "vkMapMemory");
+    return b;
+}
+
+void Gpu::State::destroy_buffer(Buffer &b)
+{
+    if (b.memory)
+        vkFreeMemory(device, b.memory, nullptr);
+    if (b.buffer)
+        vkDestroyBuffer(device, b.buffer, nullptr);
+    b = Buffer();
+}
+
+VkDescriptorSet Gpu::State::create_set(const Buffer &in, const Buffer &out)
+{
+    VkDescriptorSetAllocateInfo alloc{VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO};
+    alloc.descriptorPool = pool;
+    alloc.descriptorSetCount = 1;
+    alloc.pSetLayouts = &set_layout;
+    VkDescriptorSet set;
+    check(vkAllocateDescriptorSets(device, &alloc, &set), "vkAllocateDescriptorSets");
+
+    VkDescriptorBufferInfo buffers[2] = {
+        {in.buffer, 0, VK_WHOLE_SIZE},
+        {out.buffer, 0, VK_WHOLE_SIZE},
+    };
+    VkWriteDescriptorSet writes[2];
+    for (uint32_t i = 0; i < 2; i++) {
+        writes[i] = VkWriteDescriptorSet{VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
+        writes[i].dstSet = set;
+        writes[i].dstBinding = i;
+        writes[i].descriptorCount = 1;
+        writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writes[i].pBufferInfo = &buffers[i];
+    }
+    vkUpdateDescriptorSets(device, 2, writes, 0, nullptr);
+    return set;
+}
+
+void Gpu::State::record(Slot &slot)
+{
+    VkCommandBufferBeginInfo begin{VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+    check(vkBeginCommandBuffer(slot.cmd, &begin), "vkBeginCommandBuffer");
+
+    /* Host writes of the RAW frame must be visible to the first pass. */
+    VkMemoryBarrier barrier{VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+    barrier.srcAccessMask = VK_ACCESS_HOST_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(slot.cmd, VK_PIPELINE_STAGE_HOST_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    for (size_t i = 0; i < slot.passes.size(); i++) {
+        const Pass &pass = slot.passes[i];
+        if (i)
+            vkCmdPipelineBarrier(slot.cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                 VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr,
+                                 0, nullptr);
+        vkCmdBindPipeline(slot.cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pass.pipeline);
+        vkCmdBindDescriptorSets(slot.cmd, VK_PIPELINE_BIND_POINT_COMPUTE, layout, 0, 1, &pass.set,
+                                0, nullptr);
+        vkCmdPushConstants(slot.cmd, layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(pass.size),
+                           &pass.size);
+        vkCmdDispatch(slot.cmd, pass.groups_x, pass.groups_y, 1);
+    }
+
+    barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    vkCmdPipelineBarrier(slot.cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+                         0, 1, &barrier, 0, nullptr, 0, nullptr);
+    check(vkEndCommandBuffer(slot.cmd), "vkEndCommandBuffer");
+}
+
+Gpu::State::~State()
+{
+    if (device) {
+        vkDeviceWaitIdle(device);
+        for (Slot &slot : slots) {
+            if (slot.fence)
+                vkDestroyFence(device, slot.fence, nullptr);
+            destroy_buffer(slot.raw);
+            destroy_buffer(slot.bayer);
+            for (Buffer &b : slot.levels)
+                destroy_buffer(b);
+        }
+        if (commands)
+            vkDestroyCommandPool(device, commands, nullptr);
+        if (pool)
+            vkDestroyDescriptorPool(device, pool, nullptr);
+        for (VkPipeline p : {unpack, debayer, downscale})
+            if (p)
+                vkDestroyPipeline(device, p, nullptr);
+        if (layout)
+            vkDestroyPipelineLayout(device, layout, nullptr);
+        if (set_layout)
+            vkDestroyDescriptorSetLayout(device, set_layout, nullptr);
+        vkDestroyDevice(device, nullptr);
+    }
+    if (instance)
+        vkDestroyInstance(instance, nullptr);
+}
+
+Gpu::Gpu(uint32_t width, uint32_t height, unsigned levels, const std::string &device, unsigned slots)
+    : state_(new State)
+{
+    State &s = *state_;
+    if (width % 4 || width < 2 || height < 2)
+        throw std::runtime_error("width must be a multiple of 4, height at least 2");
+    s.width = width;
+    s.height = height;
+    s.levels = levels ? levels : 1;
+
+    const char *env = std::getenv("SKYTRACK_VKISP_DEVICE");
+    s.create_device(device.empty() && env ? env : device);
+
+    VkDescriptorSetLayoutBinding bindings[2] = {};
+    for (uint32_t i = 0; i < 2; i++) {
+        bindings[i].binding = i;
+        bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+    VkDescriptorSetLayoutCreateInfo set_info{VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO};
+    set_info.bindingCount = 2;
+    set_info.pBindings = bindings;
+    check(vkCreateDescriptorSetLayout(s.device, &set_info, nullptr, &s.set_layout),
+          "vkCreateDescriptorSetLayout");
+
+    VkPushConstantRange range{VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PushConstants)};
+    VkPipelineLayoutCreateInfo layout_info{VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO};
+    layout_info.setLayoutCount = 1;
+    layout_info.pSetLayouts = &s.set_layout;
+    layout_info.pushConstantRangeCount = 1;
+    layout_info.pPushConstantRanges = &range;
+    check(vkCreatePipelineLayout(s.device, &layout_info, nullptr, &s.layout), "vkCreatePipelineLayout");
+
+    s.unpack = s.create_pipeline(raw10_unpack_spv, sizeof(raw10_unpack_spv));
+    s.debayer = s.create_pipeline(debayer_spv, sizeof(debayer_spv));
+    s.downscale = s.create_pipeline(downscale_spv, sizeof(downscale_spv));
+
+    /* unpack, debayer and one downscale per extra level, in every slot */
+    slots = slots ? slots : 1;
+    uint32_t sets = slots * (s.levels + 1);
+    VkDescriptorPoolSize pool_size{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2 * sets};
+    VkDescriptorPoolCreateInfo pool_info{VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO};
+    pool_info.maxSets = sets;
+    pool_info.poolSizeCount = 1;
+    pool_info.pPoolSizes = &pool_size;
+    check(vkCreateDescriptorPool(s.device, &pool_info, nullptr, &s.pool), "vkCreateDescriptorPool");
+
+    VkCommandPoolCreateInfo command_info{VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO};
+    command_info.queueFamilyIndex = s.family;
+    check(vkCreateCommandPool(s.device, &command_info, nullptr, &s.commands), "vkCreateCommandPool");
+
+    s.slots.resize(slots);
+    for (Slot &slot : s.slots) {
+        /* Storage buffers are read as uints, so round the RAW frame up. */
+        slot.raw = s.create_buffer((raw10_size(width, height) + 3) & ~size_t(3));
+        slot.bayer = s.create_buffer(size_t(width) * height * sizeof(uint16_t));
+        slot.levels.resize(s.levels);
+        for (unsigned l = 0; l < s.levels; l++) {
+            size_t pixels = size_t(width >> l) * (height >> l);
+            slot.levels[l] = s.create_buffer((pixels ? pixels : 1) * sizeof(uint32_t));
+        }
+
+        slot.passes.push_back({s.unpack, s.create_set(slot.raw, slot.bayer), {width, height},
+                               groups(width / 4, GROUP_X), groups(height, GROUP_Y)});
+        slot.passes.push_back({s.debayer, s.create_set(slot.bayer, slot.levels[0]), {width, height},
+                               groups(width, GROUP_X), groups(height, GROUP_Y)});
+        for (unsigned l = 1; l < s.levels; l++) {
+            uint32_t w = width >> (l - 1), h = height >> (l - 1);
+            slot.passes.push_back({s.downscale, s.create_set(slot.levels[l - 1], slot.levels[l]),
+                                   {w, h}, groups(w / 2, GROUP_X), groups(h / 2, GROUP_Y)});
+        }
+
+        VkCommandBufferAllocateInfo alloc{VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+        alloc.commandPool = s.commands;
+        alloc.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        alloc.commandBufferCount = 1;
+        check(vkAllocateCommandBuffers(s.device, &alloc, &slot.cmd), "vkAllocateCommandBuffers");
+        s.record(slot);
+
+        VkFenceCreateInfo fence_info{VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
+        check(vkCreateFence(s.device, &fence_info, nullptr, &slot.fence), "vkCreateFence");
+    }
+}
+
+Gpu::~Gpu() = default;
+
+const std::string &Gpu::device_name() const
+{
+    return state_->name;
+}
+
+unsigned Gpu::submit(const uint8_t *raw)
+{
+    State &s = *state_;
+    unsigned index = s.next;
+    Slot &slot = s.slots[index];
+    s.next = (s.next + 1) % s.slots.size();
+
+    if (slot.busy) {
+        check(vkWaitForFences(s.device, 1, &slot.fence, VK_TRUE, UINT64_MAX), "vkWaitForFences");
+        slot.busy = false;
+    }
+    check(vkResetFences(s.device, 1, &slot.fence), "vkResetFences");
+    std::memcpy(slot.raw.map, raw, raw10_size(s.width, s.height));
+
+    VkSubmitInfo info{VK_STRUCTURE_TYPE_SUBMIT_INFO};
+    info.commandBufferCount = 1;
+    info.pCommandBuffers = &slot.cmd;
+    check(vkQueueSubmit(s.queue, 1, &info, slot.fence), "vkQueueSubmit");
+    slot.busy = true;
+    return index;
+}
+
+void Gpu::wait(unsigned index, Pyramid &out)
+{
+    State &s = *state_;
+    Slot &slot = s.slots.at(index);
+    if (!slot.busy)
+        throw std::runtime_error("slot " + std::to_string(index) + " has no frame queued");
+    check(vkWaitForFences(s.device, 1, &slot.fence, VK_TRUE, UINT64_MAX), "vkWaitForFences");
+    slot.busy = false;
+
+    out.width = s.width;
+    out.height = s.height;
+    out.levels.resize(s.levels);
+    for (unsigned l = 0; l < s.levels; l++) {
+        size_t pixels = size_t(s.width >> l) * (s.height >> l);
+        out.levels[l].resize(pixels);
+        std::memcpy(out.levels[l].data(), slot.levels[l].map, pixels * sizeof(uint32_t));
+    }
+}
+
+} // namespace skytrack::vkisp
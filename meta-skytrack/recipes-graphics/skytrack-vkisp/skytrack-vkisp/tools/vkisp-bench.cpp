@@ -0,0 +1,85 @@
+/*
+ * Time per frame of the CPU and the Vulkan backend at one resolution, to
+ * decide which one a device should use. The GPU is fed like the camera
+ * pipeline feeds it, with the next frame submitted before the previous one
+ * is collected.
+ *
+ * usage: vkisp-bench [width height levels frames]
+ */
+
+#include "skytrack/vkisp.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <stdexcept>
+
+using namespace skytrack::vkisp;
+using clock_type = std::chrono::steady_clock;
+
+namespace {
+
+double ms_since(clock_type::time_point start, unsigned frames)
+{
+    return std::chrono::duration<double, std::milli>(clock_type::now() - start).count() / frames;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    uint32_t width = argc > 4 ? std::strtoul(argv[1], nullptr, 0) : 1920;
+    uint32_t height = argc > 4 ? std::strtoul(argv[2], nullptr, 0) : 1080;
+    unsigned levels = argc > 4 ? std::strtoul(argv[3], nullptr, 0) : 4;
+    unsigned frames = argc > 4 ? std::strtoul(argv[4], nullptr, 0) : 100;
+
+    std::vector<uint8_t> raw(raw10_size(width, height));
+    std::mt19937 rng(1);
+    for (uint8_t &b : raw)
+        b = static_cast<uint8_t>(rng());
+
+    Pyramid out;
+    std::printf("%ux%u, %u levels, %u frames\n", width, height, levels, frames);
+
+    std::vector<uint16_t> bayer(size_t(width) * height);
+    auto start = clock_type::now();
+    for (unsigned i = 0; i < frames; i++)
+        cpu::unpack_raw10_scalar(raw.data(), bayer.data(), width, height);
+    std::printf("%-24s %8.3f ms\n", "cpu unpack scalar", ms_since(start, frames));
+    start = clock_type::now();
+    for (unsigned i = 0; i < frames; i++)
+        cpu::unpack_raw10(raw.data(), bayer.data(), width, height);
+    std::printf("%-24s %8.3f ms\n", "cpu unpack", ms_since(start, frames));
+
+    start = clock_type::now();
+    for (unsigned i = 0; i < frames; i++)
+        cpu::process(raw.data(), width, height, levels, out);
+    std::printf("%-24s %8.3f ms\n", "cpu frame", ms_since(start, frames));
+
+    try {
+        Gpu gpu(width, height, levels);
+        gpu.wait(gpu.submit(raw.data()), out);
+
+        start = clock_type::now();
+        for (unsigned i = 0; i < frames; i++)
+            gpu.wait(gpu.submit(raw.data()), out);
+        std::printf("%-24s %8.3f ms (%s)\n", "gpu frame latency", ms_since(start, frames),
+                    gpu.device_name().c_str());
+
+        start = clock_type::now();
+        unsigned previous = gpu.submit(raw.data());
+        for (unsigned i = 1; i < frames; i++) {
+            unsigned slot = gpu.submit(raw.data());
+            gpu.wait(previous, out);
+            previous = slot;
+        }
+        gpu.wait(previous, out);
+        std::printf("%-24s %8.3f ms (%s)\n", "gpu frame pipelined", ms_since(start, frames),
+                    gpu.device_name().c_str());
+    } catch (const std::runtime_error &e) {
+        std::printf("gpu: %s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,84 @@
+/*
+ * RTSP server for the skytrack camera.
+ *
+ * The media factory is shared, so the capture and encode pipeline runs once
+ * and every client gets the same payloaded RTP buffers. gst-rtsp-server hands
+ * them to one multiudpsink per stream, which sends to all clients with
+ * sendmmsg() batches instead of a write per packet per client.
+ */
+
+#include <gst/gst.h>
+#include <gst/rtsp-server/rtsp-server.h>
+
+#define DEFAULT_PORT "8554"
+#define DEFAULT_MOUNT "/camera"
+#define DEFAULT_LAUNCH \
+    "( libcamerasrc ! video/x-raw,width=1920,height=1080,framerate=30/1 ! " \
+    "videoconvert ! " \
+    "x264enc tune=zerolatency speed-preset=ultrafast bitrate=4000 key-int-max=30 ! " \
+    "h264parse ! rtph264pay name=pay0 pt=96 config-interval=-1 )"
+
+int main(int argc, char *argv[])
+{
+    gchar *port = NULL;
+    gchar *mount = NULL;
+    gchar *launch = NULL;
+    GOptionEntry entries[] = {
+        { "port", 'p', 0, G_OPTION_ARG_STRING, &port,
+          "Port to listen on (default: " DEFAULT_PORT ")", "PORT" },
+        { "mount", 'm', 0, G_OPTION_ARG_STRING, &mount,
+          "Mount point of the stream (default: " DEFAULT_MOUNT ")", "PATH" },
+        { "launch", 'l', 0, G_OPTION_ARG_STRING, &launch,
+          "Pipeline description, must contain a payloader named pay0", "PIPELINE" },
+        { NULL }
+    };
+    GOptionContext *context;
+    GError *error = NULL;
+    GMainLoop *loop;
+    GstRTSPServer *server;
+    GstRTSPMountPoints *mounts;
+    GstRTSPMediaFactory *factory;
+
+    context = g_option_context_new("- skytrack RTSP server");
+    g_option_context_add_main_entries(context, entries, NULL);
+    g_option_context_add_group(context, gst_init_get_option_group());
+    if (!g_option_context_parse(context, &argc, &argv, &error)) {
+        g_printerr("%s\n", error->message);
+        g_clear_error(&error);
+        g_option_context_free(context);
+        return 1;
+    }
+    g_option_context_free(context);
+
+    loop = g_main_loop_new(NULL, FALSE);
+
+    server = gst_rtsp_server_new();
+    gst_rtsp_server_set_service(server, port ? port : DEFAULT_PORT);
+
+    factory = gst_rtsp_media_factory_new();
+    gst_rtsp_media_factory_set_launch(factory, launch ? launch : DEFAULT_LAUNCH);
+    gst_rtsp_media_factory_set_shared(factory, TRUE);
+    /* Keep encoding between clients so a new viewer gets a keyframe quickly. */
+    gst_rtsp_media_factory_set_suspend_mode(factory, GST_RTSP_SUSPEND_MODE_NONE);
+
+    mounts = gst_rtsp_server_get_mount_points(server);
+    gst_rtsp_mount_points_add_factory(mounts, mount ? mount : DEFAULT_MOUNT, factory);
+    g_object_unref(mounts);
+
+    if (gst_rtsp_server_attach(server, NULL) == 0) {
+        g_printerr("failed to attach the server\n");
+        return 1;
+    }
+
+    g_print("stream ready at rtsp://127.0.0.1:%s%s\n",
+            port ? port : DEFAULT_PORT, mount ? mount : DEFAULT_MOUNT);
+    g_main_loop_run(loop);
+
+    g_object_unref(server);
+    g_main_loop_unref(loop);
+    g_free(port);
+    g_free(mount);
+    g_free(launch);
+
+    return 0;
+}
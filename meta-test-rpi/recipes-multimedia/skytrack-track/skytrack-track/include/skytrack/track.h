@@ -0,0 +1,146 @@
+/*
+ * Small target detection and tracking against an empty sky.
+ *
+ * Works on the luma plane of the ISP's low resolution output. Every frame
+ * is compared with a running background; pixels that differ by more than a
+ * threshold are counted per 8x8 cell, neighbouring hot cells are joined into
+ * blobs, and blobs are associated with the tracks of earlier frames by
+ * nearest predicted position. The per pixel work is split into row bands
+ * run by a worker pool, each band with NEON on aarch64.
+ */
+
+#ifndef SKYTRACK_TRACK_H
+#define SKYTRACK_TRACK_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace skytrack::track {
+
+/* Side of the square cells motion is counted in, in pixels. */
+constexpr unsigned CELL = 8;
+
+struct Params {
+    /* Luma difference to the background that counts as motion. */
+    unsigned threshold = 12;
+    /* The background moves 1/2^learn_shift of the way to each frame. */
+    unsigned learn_shift = 4;
+    /* Moving pixels a cell needs to be part of a blob. */
+    unsigned min_pixels = 2;
+    /* Largest distance, in pixels, between a track's prediction and a blob. */
+    float gate = 16.0f;
+    /* Frames a track survives without a blob. */
+    unsigned max_missed = 5;
+    /* Frames a track needs before it is reported. */
+    unsigned confirm = 2;
+    /* Worker threads for the per pixel work, 0 for one per core. */
+    unsigned threads = 0;
+};
+
+struct Target {
+    unsigned id = 0;
+    /* Centre and size in pixels of the frame the detector was given. */
+    float x = 0, y = 0;
+    float width = 0, height = 0;
+    /* Motion in pixels per frame. */
+    float vx = 0, vy = 0;
+    unsigned pixels = 0;
+    unsigned age = 0;
+    unsigned missed = 0;
+};
+
+/* Fixed set of threads that run one function over a range of indices. */
+class WorkerPool {
+public:
+    explicit WorkerPool(unsigned threads);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool &) = delete;
+    WorkerPool &operator=(const WorkerPool &) = delete;
+
+    unsigned size() const { return static_cast<unsigned>(threads_.size()) + 1; }
+
+    /* Call fn(i) for every i < count and wait; the caller runs a share too. */
+    void run(unsigned count, const std::function<void(unsigned)> &fn);
+
+private:
+    void work();
+    void drain();
+
+    std::vector<std::thread> threads_;
+    std::mutex mutex_;
+    std::condition_variable start_;
+    std::condition_variable done_;
+    const std::function<void(unsigned)> *fn_ = nullptr;
+    unsigned count_ = 0;
+    unsigned next_ = 0;
+    unsigned finished_ = 0;
+    unsigned generation_ = 0;
+    bool stop_ = false;
+};
+
+namespace kernel {
+
+/*
+ * One row: update the background (luma in 9.7 fixed point) and add the
+ * number of moving pixels of every CELL wide column to counts. The scalar
+ * version is the reference; the default one uses NEON where available.
+ */
+void row_scalar(const uint8_t *luma, int16_t *background, uint16_t *counts, unsigned width,
+                const Params &params);
+void row(const uint8_t *luma, int16_t *background, uint16_t *counts, unsigned width,
+         const Params &params);
+
+} // namespace kernel
+
+class Detector {
+public:
+    /* Pixels past the last full cell in either direction are ignored. */
+    Detector(unsigned width, unsigned height, const Params &params = Params());
+
+    unsigned width() const { return width_; }
+    unsigned height() const { return height_; }
+
+    /* Feed one luma plane and return the confirmed tracks. */
+    const std::vector<Target> &process(const uint8_t *luma, size_t stride);
+
+    /* Moving pixels per cell of the last frame, row by row. */
+    const std::vector<uint16_t> &counts() const { return counts_; }
+
+private:
+    struct Blob {
+        float x, y;
+        float width, height;
+        unsigned pixels;
+    };
+
+    void band(unsigned index, const uint8_t *luma, size_t stride);
+    void find_blobs();
+    void associate();
+
+    unsigned width_;
+    unsigned height_;
+    unsigned cells_x_;
+    unsigned cells_y_;
+    Params params_;
+    bool primed_ = false;
+    unsigned next_id_ = 1;
+
+    WorkerPool pool_;
+    unsigned bands_;
+    std::vector<int16_t> background_;
+    std::vector<uint16_t> counts_;
+    std::vector<unsigned> labels_;
+    std::vector<Blob> blobs_;
+    std::vector<Target> tracks_;
+    std::vector<Target> confirmed_;
+};
+
+} // namespace skytrack::track
+
+#endif
@@ -0,0 +1,309 @@
+/*
+ * Detector and worker pool. The per pixel kernel is the only part that
+ * runs in the pool; blob labelling and tracking work on the cell grid,
+ * which is 64 times smaller, on the calling thread.
+ */
+
+#include "skytrack/track.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define SKYTRACK_TRACK_NEON 1
+#endif
+
+namespace skytrack::track {
+
+WorkerPool::WorkerPool(unsigned threads)
+{
+    if (!threads)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned i = 1; i < threads; i++)
+        threads_.emplace_back(&WorkerPool::work, this);
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    start_.notify_all();
+    for (std::thread &t : threads_)
+        t.join();
+}
+
+void WorkerPool::run(unsigned count, const std::function<void(unsigned)> &fn)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        fn_ = &fn;
+        count_ = count;
+        next_ = 0;
+        finished_ = 0;
+        generation_++;
+    }
+    start_.notify_all();
+    drain();
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [this] { return finished_ == count_; });
+    fn_ = nullptr;
+}
+
+void WorkerPool::work()
+{
+    unsigned seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            start_.wait(lock, [&] { return stop_ || generation_ != seen; });
+            if (stop_)
+                return;
+            seen = generation_;
+        }
+        drain();
+    }
+}
+
+void WorkerPool::drain()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (fn_ && next_ < count_) {
+        unsigned i = next_++;
+        const std::function<void(unsigned)> &fn = *fn_;
+        lock.unlock();
+        fn(i);
+        lock.lock();
+        if (++finished_ == count_)
+            done_.notify_all();
+    }
+}
+
+namespace kernel {
+
+namespace {
+
+/* Background update of one pixel, returns whether it moved. */
+inline bool pixel(uint8_t luma, int16_t &background, int threshold, unsigned shift)
+{
+    int delta = (luma << 7) - background;
+    background = static_cast<int16_t>(background + (delta >> shift));
+    return std::abs(delta) > threshold;
+}
+
+} // namespace
+
+void row_scalar(const uint8_t *luma, int16_t *background, uint16_t *counts, unsigned width,
+                const Params &params)
+{
+    int threshold = static_cast<int>(params.threshold) << 7;
+    for (unsigned x = 0; x < width; x++)
+        counts[x / CELL] += pixel(luma[x], background[x], threshold, params.learn_shift);
+}
+
+#ifdef SKYTRACK_TRACK_NEON
+
+void row(const uint8_t *luma, int16_t *background, uint16_t *counts, unsigned width,
+         const Params &params)
+{
+    int threshold = static_cast<int>(params.threshold) << 7;
+    const int16x8_t limit = vdupq_n_s16(static_cast<int16_t>(threshold));
+    /* A negative count makes vshl an arithmetic right shift, like >>. */
+    const int16x8_t shift = vdupq_n_s16(-static_cast<int16_t>(params.learn_shift));
+    unsigned x = 0;
+
+    /* 16 pixels, i.e. two cells, per iteration. */
+    for (; x + 16 <= width; x += 16) {
+        uint8x16_t l = vld1q_u8(luma + x);
+        int16x8_t b0 = vld1q_s16(background + x);
+        int16x8_t b1 = vld1q_s16(background + x + 8);
+        int16x8_t d0 = vsubq_s16(vreinterpretq_s16_u16(vshll_n_u8(vget_low_u8(l), 7)), b0);
+        int16x8_t d1 = vsubq_s16(vreinterpretq_s16_u16(vshll_n_u8(vget_high_u8(l), 7)), b1);
+        vst1q_s16(background + x, vaddq_s16(b0, vshlq_s16(d0, shift)));
+        vst1q_s16(background + x + 8, vaddq_s16(b1, vshlq_s16(d1, shift)));
+        uint16x8_t m0 = vshrq_n_u16(vcgtq_s16(vabsq_s16(d0), limit), 15);
+        uint16x8_t m1 = vshrq_n_u16(vcgtq_s16(vabsq_s16(d1), limit), 15);
+        counts[x / CELL] += vaddvq_u16(m0);
+        counts[x / CELL + 1] += vaddvq_u16(m1);
+    }
+    for (; x < width; x++)
+        counts[x / CELL] += pixel(luma[x], background[x], threshold, params.learn_shift);
+}
+
+#else
+
+void row(const uint8_t *luma, int16_t *background, uint16_t *counts, unsigned width,
+         const Params &params)
+{
+    row_scalar(luma, background, counts, width, params);
+}
+
+#endif
+
+} // namespace kernel
+
+Detector::Detector(unsigned width, unsigned height, const Params &params)
+    : width_(width / CELL * CELL), height_(height / CELL * CELL), cells_x_(width / CELL),
+      cells_y_(height / CELL), params_(params), pool_(params.threads)
+{
+    /* Keep threshold << 7 and the shifted difference within int16_t. */
+    params_.threshold = std::min(params_.threshold, 255u);
+    params_.learn_shift = std::clamp(params_.learn_shift, 1u, 15u);
+    /* A few bands per thread even out rows with more motion than others. */
+    bands_ = std::max(1u, std::min(cells_y_, 4 * pool_.size()));
+    background_.resize(size_t(width_) * height_);
+    counts_.resize(size_t(cells_x_) * cells_y_);
+    labels_.resize(counts_.size());
+}
+
+void Detector::band(unsigned index, const uint8_t *luma, size_t stride)
+{
+    unsigned first = cells_y_ * index / bands_;
+    unsigned last = cells_y_ * (index + 1) / bands_;
+
+    std::fill(counts_.begin() + size_t(first) * cells_x_, counts_.begin() + size_t(last) * cells_x_, 0);
+    for (unsigned y = first * CELL; y < last * CELL; y++)
+        kernel::row(luma + y * stride, background_.data() + size_t(y) * width_,
+                    counts_.data() + size_t(y / CELL) * cells_x_, width_, params_);
+}
+
+const std::vector<Target> &Detector::process(const uint8_t *luma, size_t stride)
+{
+    if (!primed_) {
+        for (unsigned y = 0; y < height_; y++)
+            for (unsigned x = 0; x < width_; x++)
+                background_[size_t(y) * width_ + x] = static_cast<int16_t>(luma[y * stride + x] << 7);
+        primed_ = true;
+        return confirmed_;
+    }
+
+    pool_.run(bands_, [&](unsigned i) { band(i, luma, stride); });
+    find_blobs();
+    associate();
+    return confirmed_;
+}
+
+void Detector::find_blobs()
+{
+    std::vector<unsigned> stack;
+
+    blobs_.clear();
+    std::fill(labels_.begin(), labels_.end(), 0);
+    for (unsigned start = 0; start < counts_.size(); start++) {
+        if (labels_[start] || counts_[start] < params_.min_pixels)
+            continue;
+
+        /* Flood fill the 8-connected hot cells around start. */
+        unsigned label = static_cast<unsigned>(blobs_.size()) + 1;
+        unsigned x0 = cells_x_, y0 = cells_y_, x1 = 0, y1 = 0;
+        double sx = 0, sy = 0, total = 0;
+        labels_[start] = label;
+        stack.assign(1, start);
+        while (!stack.empty()) {
+            unsigned cell = stack.back();
+            stack.pop_back();
+            unsigned cx = cell % cells_x_, cy = cell / cells_x_;
+            double n = counts_[cell];
+            sx += n * (cx + 0.5);
+            sy += n * (cy + 0.5);
+            total += n;
+            x0 = std::min(x0, cx);
+            x1 = std::max(x1, cx);
+            y0 = std::min(y0, cy);
+            y1 = std::max(y1, cy);
+            for (int dy = -1; dy <= 1; dy++) {
+                for (int dx = -1; dx <= 1; dx++) {
+                    int nx = int(cx) + dx, ny = int(cy) + dy;
+                    if (nx < 0 || ny < 0 || nx >= int(cells_x_) || ny >= int(cells_y_))
+                        continue;
+                    unsigned next = unsigned(ny) * cells_x_ + unsigned(nx);
+                    if (!labels_[next] && counts_[next] >= params_.min_pixels) {
+                        labels_[next] = label;
+                        stack.push_back(next);
+                    }
+                }
+            }
+        }
+
+        blobs_.push_back({ float(sx / total * CELL), float(sy / total * CELL),
+                           float((x1 - x0 + 1) * CELL), float((y1 - y0 + 1) * CELL),
+                           unsigned(total) });
+    }
+}
+
+void Detector::associate()
+{
+    struct Pair {
+        float distance;
+        unsigned track;
+        unsigned blob;
+    };
+    std::vector<Pair> pairs;
+    std::vector<bool> track_used(tracks_.size()), blob_used(blobs_.size());
+
+    for (unsigned t = 0; t < tracks_.size(); t++) {
+        float px = tracks_[t].x + tracks_[t].vx, py = tracks_[t].y + tracks_[t].vy;
+        for (unsigned b = 0; b < blobs_.size(); b++) {
+            float d = std::hypot(blobs_[b].x - px, blobs_[b].y - py);
+            if (d <= params_.gate)
+                pairs.push_back({ d, t, b });
+        }
+    }
+    std::sort(pairs.begin(), pairs.end(),
+              [](const Pair &a, const Pair &b) { return a.distance < b.distance; });
+
+    for (const Pair &p : pairs) {
+        if (track_used[p.track] || blob_used[p.blob])
+            continue;
+        track_used[p.track] = blob_used[p.blob] = true;
+        Target &t = tracks_[p.track];
+        const Blob &b = blobs_[p.blob];
+        float vx = b.x - t.x, vy = b.y - t.y;
+        /* Smooth the velocity once there is one to smooth. */
+        t.vx = t.age > 1 ? (t.vx + vx) / 2 : vx;
+        t.vy = t.age > 1 ? (t.vy + vy) / 2 : vy;
+        t.x = b.x;
+        t.y = b.y;
+        t.width = b.width;
+        t.height = b.height;
+        t.pixels = b.pixels;
+        t.age++;
+        t.missed = 0;
+    }
+
+    for (unsigned t = 0; t < tracks_.size(); t++) {
+        if (track_used[t])
+            continue;
+        tracks_[t].x += tracks_[t].vx;
+        tracks_[t].y += tracks_[t].vy;
+        tracks_[t].missed++;
+    }
+    tracks_.erase(std::remove_if(tracks_.begin(), tracks_.end(),
+                                 [this](const Target &t) { return t.missed > params_.max_missed; }),
+                  tracks_.end());
+
+    for (unsigned b = 0; b < blobs_.size(); b++) {
+        if (blob_used[b])
+            continue;
+        Target t;
+        t.id = next_id_++;
+        t.x = blobs_[b].x;
+        t.y = blobs_[b].y;
+        t.width = blobs_[b].width;
+        t.height = blobs_[b].height;
+        t.pixels = blobs_[b].pixels;
+        t.age = 1;
+        tracks_.push_back(t);
+    }
+
+    confirmed_.clear();
+    for (const Target &t : tracks_)
+        if (t.age >= params_.confirm && !t.missed)
+            confirmed_.push_back(t);
+}
+
+} // namespace skytrack::track
@@ -0,0 +1,190 @@
+/*
+ * rpicam-apps post-processing stage "skytrack_track".
+ *
+ * Process() runs on the post-processing thread of the app, which every
+ * frame passes through on its way to the encoder. All it does there is copy
+ * the luma plane of the low resolution stream and hand it to a detection
+ * thread, so the full resolution frame moves on at once. A frame that
+ * arrives while detection is still busy with an earlier one is passed on
+ * without being looked at, and the count of those is logged when the stage
+ * stops. Every frame carries the latest confirmed tracks, scaled to the
+ * main stream, as "skytrack.targets" metadata.
+ *
+ * Once a second the detection thread also writes the frame and skipped
+ * frame counts, as one "frames skipped" line, to the file named by the
+ * "stats" parameter (default /run/skytrack-track/frames, "" to disable).
+ * skytrack-update throttles a background install on them.
+ *
+ * Parameters (all optional): threshold, learn_shift, min_pixels, gate,
+ * max_missed, confirm, threads, see Params in skytrack/track.h, and stats.
+ */
+
+#include "skytrack/track.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+
+#include "core/logging.hpp"
+#include "core/rpicam_app.hpp"
+#include "post_processing_stages/post_processing_stage.hpp"
+
+using namespace skytrack::track;
+
+#define NAME "skytrack_track"
+
+namespace {
+
+class SkytrackTrackStage : public PostProcessingStage
+{
+public:
+    explicit SkytrackTrackStage(RPiCamApp *app) : PostProcessingStage(app) {}
+
+    char const *Name() const override { return NAME; }
+
+    void Read(boost::property_tree::ptree const &params) override;
+    void Configure() override;
+    bool Process(CompletedRequestPtr &completed_request) override;
+    void Stop() override;
+
+private:
+    void detect();
+    void publish(unsigned frames, unsigned skipped, bool force);
+
+    Params params_;
+    std::string stats_ = "/run/skytrack-track/frames";
+    std::chrono::steady_clock::time_point published_;
+    Stream *lores_stream_ = nullptr;
+    StreamInfo lores_info_;
+    float scale_x_ = 1.0f;
+    float scale_y_ = 1.0f;
+    std::unique_ptr<Detector> detector_;
+    std::vector<uint8_t> luma_;
+    std::future<void> future_;
+
+    std::mutex mutex_;
+    std::vector<Target> targets_;
+    unsigned frames_ = 0;
+    unsigned skipped_ = 0;
+};
+
+void SkytrackTrackStage::Read(boost::property_tree::ptree const &params)
+{
+    params_.threshold = params.get<unsigned>("threshold", params_.threshold);
+    params_.learn_shift = params.get<unsigned>("learn_shift", params_.learn_shift);
+    params_.min_pixels = params.get<unsigned>("min_pixels", params_.min_pixels);
+    params_.gate = params.get<float>("gate", params_.gate);
+    params_.max_missed = params.get<unsigned>("max_missed", params_.max_missed);
+    params_.confirm = params.get<unsigned>("confirm", params_.confirm);
+    params_.threads = params.get<unsigned>("threads", params_.threads);
+    stats_ = params.get<std::string>("stats", stats_);
+}
+
+void SkytrackTrackStage::Configure()
+{
+    lores_stream_ = app_->LoresStream(&lores_info_);
+    if (!lores_stream_)
+        throw std::runtime_error(NAME ": needs a lores stream, pass --lores-width and --lores-height");
+
+    StreamInfo main_info;
+    if (app_->GetMainStream())
+        main_info = app_->GetStreamInfo(app_->GetMainStream());
+    else
+        main_info = lores_info_;
+    scale_x_ = float(main_info.width) / lores_info_.width;
+    scale_y_ = float(main_info.height) / lores_info_.height;
+
+    detector_ = std::make_unique<Detector>(lores_info_.width, lores_info_.height, params_);
+    luma_.resize(size_t(detector_->width()) * detector_->height());
+    targets_.clear();
+    frames_ = skipped_ = 0;
+
+    std::error_code ec;
+    if (!stats_.empty())
+        std::filesystem::create_directories(std::filesystem::path(stats_).parent_path(), ec);
+}
+
+void SkytrackTrackStage::detect()
+{
+    std::vector<Target> targets = detector_->process(luma_.data(), detector_->width());
+    for (Target &t : targets) {
+        t.x *= scale_x_;
+        t.y *= scale_y_;
+        t.width *= scale_x_;
+        t.height *= scale_y_;
+        t.vx *= scale_x_;
+        t.vy *= scale_y_;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    targets_ = std::move(targets);
+    for (const Target &t : targets_)
+        LOG(2, NAME ": track " << t.id << " at " << t.x << "," << t.y << " moving "
+                               << t.vx << "," << t.vy << " px/frame");
+}
+
+void SkytrackTrackStage::publish(unsigned frames, unsigned skipped, bool force)
+{
+    auto now = std::chrono::steady_clock::now();
+    if (stats_.empty() || (!force && now - published_ < std::chrono::seconds(1)))
+        return;
+    published_ = now;
+
+    /* Readers poll the file, so replace it in one step. */
+    std::string tmp = stats_ + ".tmp";
+    std::ofstream(tmp) << frames << " " << skipped << "\n";
+    if (std::rename(tmp.c_str(), stats_.c_str())) {
+        LOG_ERROR(NAME ": cannot write " << stats_ << ", not publishing frame counts");
+        stats_.clear();
+    }
+}
+
+bool SkytrackTrackStage::Process(CompletedRequestPtr &completed_request)
+{
+    frames_++;
+    if (future_.valid() && future_.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+        skipped_++;
+    } else {
+        if (future_.valid())
+            future_.get();
+
+        /* The buffer goes back to the camera after this frame, so copy the rows. */
+        BufferReadSync r(app_, completed_request->buffers[lores_stream_]);
+        const uint8_t *luma = r.Get()[0].data();
+        for (unsigned y = 0; y < detector_->height(); y++)
+            std::copy_n(luma + size_t(y) * lores_info_.stride, detector_->width(),
+                        luma_.begin() + size_t(y) * detector_->width());
+        future_ = std::async(std::launch::async, [this, frames = frames_, skipped = skipped_] {
+            detect();
+            publish(frames, skipped, false);
+        });
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    completed_request->post_process_metadata.Set("skytrack.targets", targets_);
+    return false;
+}
+
+void SkytrackTrackStage::Stop()
+{
+    if (future_.valid())
+        future_.wait();
+    publish(frames_, skipped_, true);
+    LOG(1, NAME ": detection ran on " << frames_ - skipped_ << " of " << frames_ << " frames");
+}
+
+PostProcessingStage *Create(RPiCamApp *app)
+{
+    return new SkytrackTrackStage(app);
+}
+
+RegisterStage reg(NAME, &Create);
+
+} // namespace
@@ -0,0 +1,77 @@
+/*
+ * Detection time per lores frame: the scalar kernel on one thread, the
+ * default kernel (NEON on aarch64) on one thread, and the full detector
+ * with its worker pool. The last number has to stay well below the frame
+ * interval, or the stage starts skipping frames.
+ *
+ * usage: skytrack-track-bench [width height frames]
+ */
+
+#include "skytrack/track.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+using namespace skytrack::track;
+using clock_type = std::chrono::steady_clock;
+
+namespace {
+
+double ms_since(clock_type::time_point start, unsigned frames)
+{
+    return std::chrono::duration<double, std::milli>(clock_type::now() - start).count() / frames;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    unsigned width = argc > 3 ? std::strtoul(argv[1], nullptr, 0) : 320;
+    unsigned height = argc > 3 ? std::strtoul(argv[2], nullptr, 0) : 240;
+    unsigned frames = argc > 3 ? std::strtoul(argv[3], nullptr, 0) : 1000;
+    width = width / CELL * CELL;
+    height = height / CELL * CELL;
+
+    std::vector<std::vector<uint8_t>> clip(8, std::vector<uint8_t>(size_t(width) * height));
+    std::mt19937 rng(1);
+    for (std::vector<uint8_t> &frame : clip)
+        for (uint8_t &l : frame)
+            l = static_cast<uint8_t>(110 + rng() % 20);
+
+    Params params;
+    std::vector<int16_t> background(size_t(width) * height);
+    std::vector<uint16_t> counts(size_t(width / CELL) * (height / CELL));
+    std::printf("%ux%u, %u frames\n", width, height, frames);
+
+    auto kernel_frames = [&](auto row) {
+        for (unsigned f = 0; f < frames; f++) {
+            const std::vector<uint8_t> &frame = clip[f % clip.size()];
+            for (unsigned y = 0; y < height; y++)
+                row(frame.data() + size_t(y) * width, background.data() + size_t(y) * width,
+                    counts.data() + size_t(y / CELL) * (width / CELL), width, params);
+        }
+    };
+
+    auto start = clock_type::now();
+    kernel_frames(kernel::row_scalar);
+    std::printf("%-24s %8.3f ms\n", "kernel scalar", ms_since(start, frames));
+    start = clock_type::now();
+    kernel_frames(kernel::row);
+    std::printf("%-24s %8.3f ms\n", "kernel", ms_since(start, frames));
+
+    for (unsigned threads : { 1u, 0u }) {
+        params.threads = threads;
+        Detector detector(width, height, params);
+        detector.process(clip[0].data(), width);
+        start = clock_type::now();
+        for (unsigned f = 0; f < frames; f++)
+            detector.process(clip[f % clip.size()].data(), width);
+        char what[32];
+        std::snprintf(what, sizeof(what), "detector, %s", threads ? "1 thread" : "pool");
+        std::printf("%-24s %8.3f ms\n", what, ms_since(start, frames));
+    }
+
+    return 0;
+}
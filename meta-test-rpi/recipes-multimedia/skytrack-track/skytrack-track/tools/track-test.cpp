@@ -0,0 +1,110 @@
+/*
+ * Checks the NEON kernel against the scalar one bit for bit, that the
+ * worker pool does not change the result, and that a small moving target
+ * on a noisy sky is followed as one track with the right motion.
+ *
+ * usage: skytrack-track-test
+ */
+
+#include "skytrack/track.h"
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+
+using namespace skytrack::track;
+
+namespace {
+
+int failures = 0;
+
+void check(bool ok, const char *what)
+{
+    std::printf("%s %s\n", ok ? "PASS" : "FAIL", what);
+    failures += !ok;
+}
+
+/* Sky with noise, and a 3x3 target at (x, y) if target is set. */
+void scene(std::vector<uint8_t> &frame, unsigned width, bool target, float x, float y,
+           std::mt19937 &rng)
+{
+    std::uniform_int_distribution<int> noise(-3, 3);
+    for (size_t i = 0; i < frame.size(); i++)
+        frame[i] = static_cast<uint8_t>(120 + noise(rng));
+    if (!target)
+        return;
+    for (int dy = -1; dy <= 1; dy++)
+        for (int dx = -1; dx <= 1; dx++)
+            frame[size_t(std::lround(y) + dy) * width + size_t(std::lround(x) + dx)] = 200;
+}
+
+} // namespace
+
+int main()
+{
+    std::mt19937 rng(1);
+    Params params;
+
+    /* 41 cells: the NEON loop covers 40 of them, the tail the last one. */
+    const unsigned row_width = 41 * CELL;
+    std::vector<uint8_t> luma(row_width);
+    std::vector<int16_t> background(row_width), background_ref(row_width);
+    std::vector<uint16_t> counts(row_width / CELL), counts_ref(counts.size());
+    bool same = true;
+    for (int16_t &b : background)
+        b = static_cast<int16_t>((rng() & 0xff) << 7);
+    background_ref = background;
+    for (int i = 0; i < 64; i++) {
+        for (uint8_t &l : luma)
+            l = static_cast<uint8_t>(rng());
+        kernel::row(luma.data(), background.data(), counts.data(), row_width, params);
+        kernel::row_scalar(luma.data(), background_ref.data(), counts_ref.data(), row_width, params);
+        same = same && background == background_ref && counts == counts_ref;
+    }
+    check(same, "kernel row matches row_scalar");
+
+    const unsigned width = 320, height = 180, frames = 40;
+    const float vx = 2.0f, vy = 1.0f;
+    std::vector<uint8_t> frame(size_t(width) * height);
+    Params single = params;
+    single.threads = 1;
+    Detector pooled(width, height, params), serial(width, height, single);
+    unsigned id = 0, seen = 0, switches = 0;
+    bool counts_match = true;
+    float first_x = 0, first_y = 0, last_x = 0, last_y = 0;
+    unsigned first = 0, last = 0;
+
+    for (unsigned f = 0; f < frames; f++) {
+        /* The first frame primes the background, with an empty sky. */
+        scene(frame, width, f > 0, 40 + vx * f, 30 + vy * f, rng);
+        const std::vector<Target> &targets = pooled.process(frame.data(), width);
+        serial.process(frame.data(), width);
+        counts_match = counts_match && pooled.counts() == serial.counts();
+        if (targets.size() != 1)
+            continue;
+        if (targets[0].id != id) {
+            switches += id != 0;
+            id = targets[0].id;
+        }
+        if (!seen++) {
+            first = f;
+            first_x = targets[0].x;
+            first_y = targets[0].y;
+        }
+        last = f;
+        last_x = targets[0].x;
+        last_y = targets[0].y;
+    }
+
+    check(counts_match, "worker pool matches one thread");
+    check(seen >= frames - 3, "target tracked on almost every frame");
+    check(!switches, "target keeps one track id");
+    /* Positions are cell centroids, so allow one cell over the whole run. */
+    float mx = (last_x - first_x) / float(last - first), my = (last_y - first_y) / float(last - first);
+    std::printf("tracked %u of %u frames, motion %.2f,%.2f px/frame\n", seen, frames, mx, my);
+    check(last > first && std::fabs(mx - vx) * (last - first) <= CELL &&
+              std::fabs(my - vy) * (last - first) <= CELL,
+          "target motion");
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,175 @@
+#
+# Update installation benchmark for the skytrack .swu images.
+#
+# Runs on a qemu image booted from skytrack-update-bench.wks, whose APP and
+# APP_b partitions stand in for the Tegra A/B rootfs slots. The .swu images
+# are served from the build host by a range-capable HTTP server, and each
+# install reports wall time, throughput, guest CPU use, bytes downloaded and
+# write amplification on the virtual disk. Results are logged and written
+# to ${TEST_LOG_DIR}/skytrack-update-bench.json.
+#
+# Last, the installed slot is booted through skytrack-kexec-slot and then
+# the machine is rebooted, and the time until ssh answers again, during
+# which tracking would be blind, is reported for both. qemu boots its
+# kernel directly, so the reboot leaves out the firmware and UEFI stages
+# of the Jetson and its number is a lower bound.
+#
+
+import json
+import os
+import time
+
+from oeqa.core.decorator.depends import OETestDepends
+from oeqa.runtime.case import OERuntimeTestCase
+
+from skytrack import rangeserver
+
+# Guest side stand-in for nvbootctrl, accepts any slot switch
+NVBOOTCTRL_STUB = r"""#!/bin/sh
+exit 0
+"""
+
+# The update scripts take the running slot from boot.slot_suffix, the tests
+# set it in this file instead
+CMDLINE = "/tmp/cmdline"
+
+DISK = "vda"
+SECTOR_SIZE = 512
+
+
+class SkytrackUpdateBenchTest(OERuntimeTestCase):
+
+    @classmethod
+    def setUpClass(cls):
+        deploy = cls.td['DEPLOY_DIR_IMAGE']
+        machine = cls.td['MACHINE']
+        fstype = cls.td.get('SKYTRACK_ROOTFS_FSTYPE') or 'ext4'
+        # The full .swu installs the booted image, the delta one a different
+        # image, so the delta has something to download.
+        full_image = '%s-%s.rootfs.%s' % (cls.td['SWUPDATE_CORE_IMAGE_NAME'], machine, fstype)
+        delta_image = '%s-%s.rootfs.%s' % (cls.td['SKYTRACK_UPDATE_BENCH_DELTA_IMAGE'], machine, fstype)
+
+        cls.full = 'swupdate-image-skytrack-full-%s.swu' % machine
+        cls.delta = 'swupdate-image-skytrack-%s.swu' % machine
+        cls.files = {}
+        cls.zck = delta_image + '.zck'
+        for name in (cls.full, cls.delta, cls.zck):
+            with open(os.path.join(deploy, name), 'rb') as f:
+                cls.files['/' + name] = f.read()
+        cls.rootfs_size = {
+            cls.full: os.path.getsize(os.path.join(deploy, full_image)),
+            cls.delta: os.path.getsize(os.path.join(deploy, delta_image)),
+        }
+
+        address = (cls.td['TEST_SERVER_IP'], int(cls.td['SKYTRACK_UPDATE_BENCH_PORT']))
+        cls.server, cls.handler = rangeserver.serve(cls.files, address=address)
+        cls.url = 'http://%s:%d' % address
+        cls.results = {}
+
+        cls.tc.target.run("cat > /usr/bin/nvbootctrl << 'EOF'\n%sEOF\nchmod +x /usr/bin/nvbootctrl"
+                          % NVBOOTCTRL_STUB)
+
+    @classmethod
+    def tearDownClass(cls):
+        cls.server.shutdown()
+        for name, result in cls.results.items():
+            cls.tc.logger.info('%s: %s' % (name, ', '.join(
+                '%s=%s' % item for item in sorted(result.items()))))
+        with open(os.path.join(cls.td['TEST_LOG_DIR'], 'skytrack-update-bench.json'), 'w') as f:
+            json.dump(cls.results, f, indent=2, sort_keys=True)
+
+    def counters(self):
+        """Busy and total CPU ticks and sectors written to the disk."""
+        status, output = self.target.run('head -n 1 /proc/stat; cat /sys/block/%s/stat' % DISK)
+        self.assertEqual(status, 0, msg=output)
+        cpu, disk = output.splitlines()[:2]
+        ticks = [int(field) for field in cpu.split()[1:]]
+        idle = ticks[3] + ticks[4]
+        return sum(ticks) - idle, sum(ticks), int(disk.split()[6])
+
+    def slot(self, suffix):
+        self.target.run('echo "boot.slot_suffix=%s" > %s' % (suffix, CMDLINE))
+
+    def install(self, name, mode, swu, env=''):
+        cmd = 'SKYTRACK_CMDLINE=%s %s skytrack-update -m %s %s/%s' % (CMDLINE, env, mode, self.url, swu)
+        size = self.rootfs_size[swu]
+        self.handler.sent = 0
+        busy, total, sectors = self.counters()
+        start = time.monotonic()
+        status, output = self.target.run(cmd, timeout=3600)
+        seconds = time.monotonic() - start
+        self.assertEqual(status, 0, msg='%s install failed:\n%s' % (name, output))
+        busy_after, total_after, sectors_after = self.counters()
+
+        written = (sectors_after - sectors) * SECTOR_SIZE
+        self.results[name] = {
+            'seconds': round(seconds, 2),
+            'throughput_mib_s': round(size / seconds / (1 << 20), 2),
+            'cpu_percent': round(100.0 * (busy_after - busy) / max(total_after - total, 1), 1),
+            'downloaded_bytes': self.handler.sent,
+            'written_bytes': written,
+            'write_amplification': round(written / size, 2),
+        }
+
+    @OETestDepends(['ssh.SSHTest.test_ssh'])
+    def test_full_install(self):
+        # Slot A is current, so this writes APP_b.
+        self.slot('')
+        self.install('full', 'full', self.full)
+
+    @OETestDepends(['skytrack_update.SkytrackUpdateBenchTest.test_full_install'])
+    def test_delta_install(self):
+        # Run "from" slot B, which now holds the full install, so the delta
+        # handler seeds APP from it and downloads only the changed chunks.
+        # The first install chunks APP_b into /data/skytrack-update/seed, the
+        # second one seeds from that copy.
+        self.slot('_b')
+        for name in ('delta', 'delta_seeded'):
+            self.install(name, 'delta', self.delta)
+            chunks = self.handler.sent - len(self.files['/' + self.delta])
+            self.assertGreater(chunks, 0, msg='delta downloaded no chunks, the images are identical')
+            self.assertLess(chunks, len(self.files['/' + self.zck]), msg='delta downloaded the whole rootfs')
+        status, output = self.target.run('ls /data/skytrack-update/seed')
+        self.assertEqual(output.split(), ['APP_b.zck'], msg='only the source slot should be kept chunked')
+        self.assertLess(self.results['delta_seeded']['seconds'], self.results['delta']['seconds'],
+                        msg='the kept chunked slot did not make the install faster')
+
+    @OETestDepends(['skytrack_update.SkytrackUpdateBenchTest.test_full_install'])
+    def test_resumed_install(self):
+        # Drop the connection three times, 1 MiB into each response.
+        self.slot('')
+        self.handler.requests = 0
+        self.handler.drops = 3
+        self.handler.drop_after = 1 << 20
+        try:
+            self.install('resumed', 'full', self.full, env='SKYTRACK_UPDATE_RETRY_DELAY=1')
+        finally:
+            self.handler.drops = 0
+        # A resuming client fetches every byte once, a restarting one more
+        self.assertEqual(self.handler.sent, len(self.files['/' + self.full]),
+                         msg='download restarted instead of resuming')
+
+    def blind(self, cmd, booted):
+        """Run cmd in the background, return seconds until ssh answers and booted succeeds."""
+        start = time.monotonic()
+        self.target.run('(sleep 1; %s) >/dev/null 2>&1 &' % cmd)
+        time.sleep(2)
+        while time.monotonic() - start < 600:
+            status, _ = self.target.run(booted, timeout=10)
+            if status == 0:
+                return round(time.monotonic() - start - 1, 2)
+            time.sleep(0.5)
+        self.fail('%s: the machine did not come back' % cmd)
+
+    @OETestDepends(['skytrack_update.SkytrackUpdateBenchTest.test_delta_install',
+                    'skytrack_update.SkytrackUpdateBenchTest.test_resumed_install'])
+    def test_kexec_blind_time(self):
+        # APP_b holds the full install of test_resumed_install, and the
+        # machine runs slot A from vda1. The kexec boots APP_b, the reboot
+        # goes back to qemu's kernel command line and so to vda1.
+        status, output = self.target.run('skytrack-kexec-slot -n')
+        self.assertEqual(status, 0, msg='loading the APP_b kernel failed:\n%s' % output)
+        self.results['kexec'] = {'blind_seconds': self.blind(
+            'skytrack-kexec-slot', 'grep -q "boot.slot_suffix=_b" /proc/cmdline')}
+        self.results['reboot'] = {'blind_seconds': self.blind(
+            'systemctl reboot', '! grep -q "boot.slot_suffix=_b" /proc/cmdline')}
@@ -0,0 +1,101 @@
+# Minimal HTTP server with range request support for the update scripts.
+#
+# Serves in-memory files with an ETag, honours If-Range, counts requests and
+# bytes sent, and can drop the connection partway through the first few
+# responses, or stall there until released, as a client sees a reboot.
+
+import hashlib
+import http.server
+import threading
+
+
+class RangeRequestHandler(http.server.BaseHTTPRequestHandler):
+    files = {}
+    drops = 0
+    stalls = 0
+    drop_after = 0
+    requests = 0
+    heads = 0
+    sent = 0
+    release = None
+
+    def do_HEAD(self):
+        type(self).heads += 1
+        self.respond(False)
+
+    def do_GET(self):
+        type(self).requests += 1
+        self.respond(True)
+
+    def respond(self, send_body):
+        cls = type(self)
+        payload = cls.files.get(self.path)
+        if payload is None:
+            self.send_error(404)
+            return
+
+        # A range of a different version of the file is answered in full
+        etag = '"%s"' % hashlib.sha256(payload).hexdigest()[:16]
+        if_range = self.headers.get("If-Range")
+
+        # "bytes=a-b,c-d,..." as sent by curl resume and by zchunk
+        header = self.headers.get("Range")
+        ranges = []
+        if header and if_range in (None, etag):
+            for spec in header.split("=", 1)[1].split(","):
+                first, _, last = spec.strip().partition("-")
+                ranges.append((int(first), int(last) if last else len(payload) - 1))
+
+        if len(ranges) > 1:
+            boundary = "skytrackrange"
+            parts = []
+            for first, last in ranges:
+                parts.append(("--%s\r\nContent-Type: application/octet-stream\r\n"
+                              "Content-Range: bytes %d-%d/%d\r\n\r\n"
+                              % (boundary, first, last, len(payload))).encode())
+                parts.append(payload[first:last + 1])
+                parts.append(b"\r\n")
+            parts.append(("--%s--\r\n" % boundary).encode())
+            body = b"".join(parts)
+            self.send_response(206)
+            self.send_header("Content-Type", "multipart/byteranges; boundary=%s" % boundary)
+        elif ranges:
+            first, last = ranges[0]
+            body = payload[first:last + 1]
+            self.send_response(206)
+            self.send_header("Content-Range", "bytes %d-%d/%d" % (first, last, len(payload)))
+        else:
+            body = payload
+            self.send_response(200)
+        self.send_header("ETag", etag)
+        self.send_header("Content-Length", str(len(body)))
+        self.end_headers()
+        if not send_body:
+            return
+
+        if cls.requests <= cls.drops + cls.stalls:
+            body = body[:cls.drop_after]
+            self.close_connection = True
+        self.wfile.write(body)
+        cls.sent += len(body)
+        if cls.drops < cls.requests <= cls.drops + cls.stalls:
+            self.wfile.flush()
+            cls.release.wait()
+
+    def log_message(self, format, *args):
+        pass
+
+
+def serve(files, drops=0, drop_after=0, address=("127.0.0.1", 0), stalls=0):
+    """Start a server, by default on a free loopback port, return (server, handler class).
+
+    The first drops GET responses end after drop_after bytes, the stalls
+    after them hang there until handler.release is set.
+    """
+    handler = type("Handler", (RangeRequestHandler,), {
+        "files": files, "drops": drops, "drop_after": drop_after, "stalls": stalls,
+        "release": threading.Event(),
+    })
+    server = http.server.ThreadingHTTPServer(address, handler)
+    threading.Thread(target=server.serve_forever, daemon=True).start()
+    return server, handler
@@ -0,0 +1,135 @@
+#!/usr/bin/env python3
+#
+# dm-verity hash tree, built on several cores.
+#
+# Writes the same superblock and hash tree as "veritysetup format" with a
+# hash offset, hash type 1 and no FEC, into the image behind its data, and
+# prints the parameters in veritysetup's format so dm-verity-img can take
+# them. veritysetup hashes the data blocks one after another on one thread;
+# here the data is cut into ranges that are hashed in parallel, and only the
+# upper levels, 128 times smaller each, are hashed in one process.
+#
+# usage: verity.py [--jobs N] [--data-block-size B] [--hash-block-size B]
+#                  [--salt HEX] [--uuid UUID] --hash-offset BYTES image
+
+import argparse
+import hashlib
+import multiprocessing
+import os
+import struct
+import sys
+import uuid
+
+ALGORITHM = "sha256"
+DIGEST_SIZE = hashlib.new(ALGORITHM).digest_size
+# Blocks hashed per task, 16 MiB of data with 4 KiB blocks
+RANGE_BLOCKS = 4096
+
+
+def hash_blocks(data, block_size, salt):
+    """Digests of each block_size block of data, salted in front."""
+    salted = hashlib.new(ALGORITHM, salt)
+    digests = []
+    for offset in range(0, len(data), block_size):
+        h = salted.copy()
+        h.update(data[offset:offset + block_size])
+        digests.append(h.digest())
+    return b"".join(digests)
+
+
+def hash_range(args):
+    path, first, count, block_size, salt = args
+    with open(path, "rb") as f:
+        data = os.pread(f.fileno(), count * block_size, first * block_size)
+    return hash_blocks(data, block_size, salt)
+
+
+def pack(digests, hash_block_size):
+    """Hash blocks holding digests, each block padded with zeros."""
+    # Digests take a power of two sized slot, for sha256 their own size
+    slot = 1 << (DIGEST_SIZE - 1).bit_length()
+    if slot != DIGEST_SIZE:
+        digests = b"".join(digests[i:i + DIGEST_SIZE].ljust(slot, b"\0")
+                           for i in range(0, len(digests), DIGEST_SIZE))
+    step = hash_block_size // slot * slot
+    return [digests[i:i + step].ljust(hash_block_size, b"\0") for i in range(0, len(digests), step)]
+
+
+def superblock(data_blocks, data_block_size, hash_block_size, salt, sb_uuid):
+    return struct.pack("<8sII16s32sIIQH6s256s168s", b"verity", 1, 1, sb_uuid.bytes,
+                       ALGORITHM.encode(), data_block_size, hash_block_size, data_blocks,
+                       len(salt), b"", salt, b"")
+
+
+def build(path, hash_offset, data_block_size=4096, hash_block_size=4096, salt=None,
+          sb_uuid=None, jobs=None):
+    """Write superblock and tree at hash_offset, return the veritysetup parameters."""
+    if hash_offset % data_block_size or hash_offset % hash_block_size:
+        raise ValueError("hash offset %d is not a multiple of the block sizes" % hash_offset)
+    salt = os.urandom(32) if salt is None else salt
+    sb_uuid = sb_uuid or uuid.uuid4()
+    data_blocks = hash_offset // data_block_size
+
+    ranges = [(path, first, min(RANGE_BLOCKS, data_blocks - first), data_block_size, salt)
+              for first in range(0, data_blocks, RANGE_BLOCKS)]
+    with multiprocessing.Pool(jobs) as pool:
+        digests = b"".join(pool.imap(hash_range, ranges))
+
+    # Level 0 holds the digests of the data blocks, each higher level those
+    # of the level below, up to a single block whose digest is the root. A
+    # single data block has no tree, its digest is the root.
+    levels = []
+    while len(digests) > DIGEST_SIZE:
+        blocks = pack(digests, hash_block_size)
+        levels.append(blocks)
+        digests = hash_blocks(b"".join(blocks), hash_block_size, salt)
+    root = digests
+
+    # veritysetup puts the superblock at the offset, then the levels from
+    # the top down, each starting on a hash block
+    with open(path, "r+b") as f:
+        position = hash_offset
+        f.seek(position)
+        f.write(superblock(data_blocks, data_block_size, hash_block_size, salt, sb_uuid))
+        position += hash_block_size
+        for blocks in reversed(levels):
+            f.seek(position)
+            f.write(b"".join(blocks))
+            position += len(blocks) * hash_block_size
+        f.truncate(position)
+
+    return [
+        ("UUID", str(sb_uuid)),
+        ("Hash type", "1"),
+        ("Data blocks", str(data_blocks)),
+        ("Data block size", str(data_block_size)),
+        ("Hash block size", str(hash_block_size)),
+        ("Hash algorithm", ALGORITHM),
+        ("Salt", salt.hex()),
+        ("Root hash", root.hex()),
+    ]
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Build a dm-verity hash tree in parallel")
+    parser.add_argument("--jobs", type=int, default=None, help="processes, default one per core")
+    parser.add_argument("--data-block-size", type=int, default=4096)
+    parser.add_argument("--hash-block-size", type=int, default=4096)
+    parser.add_argument("--hash-offset", type=int, required=True,
+                        help="end of the data and start of the superblock, in bytes")
+    parser.add_argument("--salt", help="hex, default 32 random bytes")
+    parser.add_argument("--uuid", help="superblock UUID, default a random one")
+    parser.add_argument("image")
+    args = parser.parse_args()
+
+    params = build(args.image, args.hash_offset, args.data_block_size, args.hash_block_size,
+                   bytes.fromhex(args.salt) if args.salt is not None else None,
+                   uuid.UUID(args.uuid) if args.uuid else None, args.jobs)
+    print("VERITY header information for %s" % args.image)
+    for key, value in params:
+        print("%-17s\t%s" % (key + ":", value))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
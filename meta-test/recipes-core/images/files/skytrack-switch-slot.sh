@@ -0,0 +1,12 @@
+#!/bin/sh
+#
+# The update is always written to the inactive slot, so after a successful
+# install boot the other one.
+
+if [ "$1" = "postinst" ]; then
+    # The running slot as skytrack-update sees it, see there
+    case " $(cat "${SKYTRACK_CMDLINE:-/proc/cmdline}") " in
+    *" boot.slot_suffix=_b "*) nvbootctrl set-active-boot-slot 0 ;;
+    *) nvbootctrl set-active-boot-slot 1 ;;
+    esac
+fi
@@ -0,0 +1,198 @@
+--
+-- SWUpdate image handlers of the skytrack images.
+--
+-- "skytrack_raw" writes a raw image compressed with pzstd (image_types_pzst)
+-- to its device. SWUpdate's raw handler decompresses zstd on one thread and
+-- writes through the page cache. This handler pipes the stream, as it
+-- arrives, into pzstd, which decompresses the independent frames on several
+-- cores, and GNU dd, which writes whole blocks with O_DIRECT.
+--
+-- Properties, all optional:
+--   threads    decompression threads, default one per core
+--   blocksize  dd block size, default 4M
+--   direct     "false" writes through the page cache instead
+--   cache      see skytrack_delta
+--
+-- "skytrack_delta" takes the zchunk header of the new rootfs (image_types_zck)
+-- and rebuilds the image in its device from the chunks of the active slot,
+-- downloading only the chunks that are not there. SWUpdate's delta handler
+-- does the same, but chunks the whole active slot again on every install.
+-- This one keeps the chunked slot, a .zck made with the build's zck options,
+-- under /data, where it stays valid across boots until that slot is written
+-- again. zckdl copies the matching chunks out of it and fetches the rest by
+-- HTTP range requests, the result is checked against the header from the
+-- .swu and written like skytrack_raw does.
+--
+-- Properties:
+--   url        URL of the new rootfs .zck
+--   source     block device of the active slot
+--   cache      directory for the chunked slots and the download, default
+--              /data/skytrack-update/seed
+--   blocksize  dd block size, default 4M
+--
+
+require("swupdate")
+
+local SEED_CACHE = "/data/skytrack-update/seed"
+
+local function shell_quote(s)
+    return "'" .. string.gsub(s, "'", "'\\''") .. "'"
+end
+
+local function cores()
+    local f = io.popen("nproc")
+    local n = f and tonumber(f:read("*l"))
+    if f then
+        f:close()
+    end
+    return n or 1
+end
+
+local function run(cmd)
+    local ok = os.execute(cmd)
+    return ok == true or ok == 0
+end
+
+local function exists(path)
+    local f = io.open(path)
+    if f then
+        f:close()
+    end
+    return f ~= nil
+end
+
+-- The chunked copy of a slot, named after the partition label the
+-- sw-description uses for it.
+local function seed_path(cache, device)
+    return cache .. "/" .. string.match(device, "[^/]+$") .. ".zck"
+end
+
+function skytrack_raw(image)
+    local props = image.properties or {}
+    local threads = tonumber(props.threads) or cores()
+    local blocksize = props.blocksize or "4M"
+    local oflag = props.direct == "false" and "" or " oflag=direct"
+    local status = os.tmpname()
+    -- The slot changes, so skytrack_delta must not seed from it any more
+    os.remove(seed_path(props.cache or SEED_CACHE, image.device))
+
+    -- A shell pipeline only reports dd's exit status, so pzstd leaves its
+    -- own in a file.
+    local cmd = string.format(
+        "{ pzstd -d -q -c -p %d; echo $? > %s; } | dd of=%s bs=%s iflag=fullblock%s conv=fsync status=none",
+        threads, shell_quote(status), shell_quote(image.device), blocksize, oflag)
+    swupdate.info(string.format("skytrack_raw: %s, %d threads, bs=%s%s",
+                                image.device, threads, blocksize, oflag))
+
+    local pipe = io.popen(cmd, "w")
+    if not pipe then
+        swupdate.error("skytrack_raw: cannot start " .. cmd)
+        os.remove(status)
+        return 1
+    end
+    local err, msg = image:read(function(data)
+        pipe:write(data)
+    end)
+    local written = pipe:close()
+
+    local f = io.open(status)
+    local pzstd = f and tonumber(f:read("*l"))
+    if f then
+        f:close()
+    end
+    os.remove(status)
+
+    if err ~= 0 or not written or pzstd ~= 0 then
+        swupdate.error(string.format("skytrack_raw: writing %s failed (read %s %s, pzstd %s, dd %s)",
+                                     image.device, tostring(err), tostring(msg or ""),
+                                     tostring(pzstd), tostring(written)))
+        return 1
+    end
+    return 0
+end
+
+function skytrack_delta(image)
+    local props = image.properties or {}
+    local cache = props.cache or SEED_CACHE
+    local blocksize = props.blocksize or "4M"
+    if not props.url or not props.source then
+        swupdate.error("skytrack_delta: url and source properties are required")
+        return 1
+    end
+
+    -- The target slot is about to change, its chunked copy goes first
+    local seed = seed_path(cache, props.source)
+    os.remove(seed_path(cache, image.device))
+    if not run("mkdir -p " .. shell_quote(cache)) then
+        swupdate.error("skytrack_delta: cannot create " .. cache)
+        return 1
+    end
+
+    local header = cache .. "/new.zckheader"
+    local f = io.open(header, "wb")
+    if not f then
+        swupdate.error("skytrack_delta: cannot write " .. header)
+        return 1
+    end
+    local err, msg = image:read(function(data)
+        f:write(data)
+    end)
+    f:close()
+    if err ~= 0 then
+        swupdate.error("skytrack_delta: reading the header failed: " .. tostring(msg or err))
+        os.remove(header)
+        return 1
+    end
+
+    if exists(seed) then
+        swupdate.info("skytrack_delta: seeding from " .. seed)
+    else
+        swupdate.info(string.format("skytrack_delta: chunking %s into %s", props.source, seed))
+        if not run(string.format("zck -u --chunk-hash-type sha256 --output %s %s >/dev/null",
+                                 shell_quote(seed .. ".new"), shell_quote(props.source))) or
+                not os.rename(seed .. ".new", seed) then
+            swupdate.error("skytrack_delta: chunking " .. props.source .. " failed")
+            os.remove(seed .. ".new")
+            os.remove(header)
+            return 1
+        end
+    end
+
+    -- zckdl names the download after the URL and checks every chunk
+    -- against the header it fetched, so the header has to be the one from
+    -- the signed .swu.
+    local download = cache .. "/" .. string.match(props.url, "[^/]+$")
+    os.remove(download)
+    local ok = run(string.format("cd %s && zckdl --source %s %s >/dev/null",
+                                 shell_quote(cache), shell_quote(seed), shell_quote(props.url))) and
+        run(string.format("cmp -s -n $(stat -c %%s %s) %s %s", shell_quote(header),
+                          shell_quote(header), shell_quote(download)))
+    os.remove(header)
+    if not ok then
+        swupdate.error("skytrack_delta: fetching " .. props.url .. " failed or it does not match the .swu")
+        os.remove(download)
+        return 1
+    end
+
+    swupdate.info(string.format("skytrack_delta: writing %s, bs=%s", image.device, blocksize))
+    local status = os.tmpname()
+    ok = run(string.format(
+        "{ unzck -c %s; echo $? > %s; } | dd of=%s bs=%s iflag=fullblock oflag=direct conv=fsync status=none",
+        shell_quote(download), shell_quote(status), shell_quote(image.device), blocksize))
+    f = io.open(status)
+    local unzck = f and tonumber(f:read("*l"))
+    if f then
+        f:close()
+    end
+    os.remove(status)
+    os.remove(download)
+    if not ok or unzck ~= 0 then
+        swupdate.error(string.format("skytrack_delta: writing %s failed (unzck %s)",
+                                     image.device, tostring(unzck)))
+        return 1
+    end
+    return 0
+end
+
+swupdate.register_handler("skytrack_raw", skytrack_raw, swupdate.HANDLER_MASK.IMAGE_HANDLER)
+swupdate.register_handler("skytrack_delta", skytrack_delta, swupdate.HANDLER_MASK.IMAGE_HANDLER)
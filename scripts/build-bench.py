@@ -0,0 +1,165 @@
+#!/usr/bin/env python3
+#
+# Build performance benchmark for the Jetson and RPi5 kas configurations.
+#
+# Each configuration is built in three modes:
+#   clean    empty build directory and empty sstate cache
+#   warm     empty build directory, sstate from the clean build
+#   changed  the warm build again after "bitbake -C unpack" of one recipe
+#
+# Downloads are shared through DL_DIR so the network does not skew the
+# result. Every run appends one JSON line to the history file (by default
+# build-bench.jsonl in the work directory) with wall time, task CPU time and
+# peak task RSS from buildstats, and the disk used by the build directory and
+# sstate cache, keyed by the last commit touching the layers or kas files.
+# A run exceeding the latest result of an older revision by more than the
+# threshold is flagged as a regression, and the script exits with status 2.
+#
+# usage: scripts/build-bench.py [--history FILE] [--threshold PERCENT]
+#                               [--config NAME] <work-dir>
+
+import argparse
+import glob
+import importlib.util
+import json
+import os
+import shutil
+import subprocess
+import sys
+import time
+
+TOPDIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..")
+LAYERS = ["kas", "meta-skytrack", "meta-test", "meta-test-rpi"]
+
+# name: (kas file, recipe touched in the "changed" mode)
+CONFIGS = {
+    "jetson": ("kas/jetson-orin-nano-devkit-nvme.yml", "skytrack-update"),
+    "rpi5": ("kas/raspberrypi5.yml", "skytrack-rtsp"),
+}
+
+METRICS = ["wall", "cpu", "peak_rss_kib", "disk_bytes"]
+
+spec = importlib.util.spec_from_file_location(
+    "buildstats_report", os.path.join(os.path.dirname(__file__), "buildstats-report.py"))
+buildstats = importlib.util.module_from_spec(spec)
+spec.loader.exec_module(buildstats)
+
+
+def revision():
+    return subprocess.run(["git", "log", "-1", "--format=%h", "--"] + LAYERS, cwd=TOPDIR,
+                          check=True, capture_output=True, text=True).stdout.strip()
+
+
+def kas(builddir, log, *args):
+    env = dict(os.environ, KAS_BUILD_DIR=builddir)
+    with open(log, "a") as f:
+        subprocess.run(["kas"] + list(args), cwd=TOPDIR, env=env, check=True,
+                       stdout=f, stderr=subprocess.STDOUT)
+
+
+def disk_usage(*paths):
+    total = 0
+    for path in paths:
+        for root, _, files in os.walk(path):
+            for name in files:
+                try:
+                    total += os.lstat(os.path.join(root, name)).st_size
+                except OSError:
+                    pass
+    return total
+
+
+def task_stats(builddir, since):
+    tasks = []
+    for path in glob.glob(os.path.join(builddir, "tmp*", "buildstats", "*")):
+        if os.path.getmtime(path) >= since:
+            tasks += buildstats.load(path, [])[1]
+    return sum(t.cpu for t in tasks), max((t.maxrss for t in tasks), default=0)
+
+
+def run(workdir, name, mode):
+    config, recipe = CONFIGS[name]
+    builddir = os.path.join(workdir, "%s-%s" % (name, "clean" if mode == "clean" else "warm"))
+    log = builddir + "-%s.log" % mode
+    os.environ["SSTATE_DIR"] = os.path.join(workdir, "%s-sstate" % name)
+    if mode == "clean":
+        shutil.rmtree(os.environ["SSTATE_DIR"], ignore_errors=True)
+    if mode != "changed":
+        shutil.rmtree(builddir, ignore_errors=True)
+    if os.path.exists(log):
+        os.unlink(log)
+
+    since = time.time()
+    start = time.monotonic()
+    if mode == "changed":
+        kas(builddir, log, "shell", config, "-c", "bitbake -C unpack %s" % recipe)
+    kas(builddir, log, "build", config)
+    wall = time.monotonic() - start
+
+    cpu, maxrss = task_stats(builddir, since)
+    return {
+        "wall": round(wall, 1),
+        "cpu": round(cpu, 1),
+        "peak_rss_kib": maxrss,
+        "disk_bytes": disk_usage(builddir, os.environ["SSTATE_DIR"]),
+    }
+
+
+def baseline(history, record):
+    previous = None
+    for line in history:
+        entry = json.loads(line)
+        if (entry["config"], entry["mode"]) == (record["config"], record["mode"]) \
+                and entry["revision"] != record["revision"]:
+            previous = entry
+    return previous
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Benchmark the kas builds and record the results")
+    parser.add_argument("workdir")
+    parser.add_argument("--history")
+    parser.add_argument("--threshold", type=float, default=10.0)
+    parser.add_argument("--config", action="append", choices=sorted(CONFIGS))
+    args = parser.parse_args()
+
+    workdir = os.path.abspath(args.workdir)
+    os.makedirs(workdir, exist_ok=True)
+    os.environ["DL_DIR"] = os.path.join(workdir, "downloads")
+    args.history = args.history or os.path.join(workdir, "build-bench.jsonl")
+    rev = revision()
+    regressions = 0
+
+    history = []
+    if os.path.exists(args.history):
+        with open(args.history) as f:
+            history = f.readlines()
+
+    print("%-8s %-8s %10s %10s %12s %12s" % ("config", "mode", "wall s", "cpu s", "peak rss MiB", "disk MiB"))
+    for name in args.config or sorted(CONFIGS):
+        for mode in ("clean", "warm", "changed"):
+            record = {"time": int(time.time()), "revision": rev, "config": name, "mode": mode}
+            record.update(run(workdir, name, mode))
+            print("%-8s %-8s %10.1f %10.1f %12.1f %12.1f" %
+                  (name, mode, record["wall"], record["cpu"],
+                   record["peak_rss_kib"] / 1024, record["disk_bytes"] / (1 << 20)))
+
+            previous = baseline(history, record)
+            for metric in METRICS if previous else []:
+                limit = previous[metric] * (1 + args.threshold / 100)
+                if previous[metric] and record[metric] > limit:
+                    regressions += 1
+                    print("  regression: %s %s -> %s (+%.1f%%) against %s" %
+                          (metric, previous[metric], record[metric],
+                           100 * (record[metric] / previous[metric] - 1), previous["revision"]))
+
+            line = json.dumps(record, sort_keys=True) + "\n"
+            history.append(line)
+            with open(args.history, "a") as f:
+                f.write(line)
+
+    return 2 if regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
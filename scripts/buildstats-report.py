@@ -0,0 +1,290 @@
+#!/usr/bin/env python3
+#
+# Read the buildstats tree of a build (USER_CLASSES += "buildstats") and
+# report the critical path and the per-recipe cost.
+#
+# buildstats records when each task started and ended and what it consumed,
+# but not why it waited. With the task-depends.dot from "bitbake -g <target>"
+# the critical path follows, from the last task to finish, the dependency
+# that finished last. Without it the path follows whichever task finished
+# last before the current one started, which is what held it up in practice.
+#
+# Given a second buildstats directory, the per-recipe wall and CPU time of
+# both builds are compared instead, biggest change first.
+#
+# --tail reports the end of the build instead: everything that ran after the
+# last do_rootfs finished, which is the image conversions, the tegraflash
+# archive and the .swu images. It prints how long that took, how many of
+# those tasks ran at once on average and the chain of tasks that held up
+# the end. With two directories it compares the tails of both builds.
+#
+# usage: scripts/buildstats-report.py [options] <buildstats> [<new-buildstats>]
+#
+#   <buildstats> is tmp/buildstats/<build-name>, or tmp/buildstats to take
+#   the most recent build.
+#
+#   --depends FILE  task-depends.dot for the critical path
+#   --tasks GLOBS   only count tasks matching these comma separated globs,
+#                   e.g. "do_fetch,do_unpack" or "do_image*"
+#   --top N         number of recipes to list (default 20)
+#   --tail          report the tasks after the last do_rootfs
+
+import argparse
+import fnmatch
+import os
+import re
+import sys
+
+PR_SUFFIX = re.compile(r"^(.*)-[^-]+-r[0-9.]+$")
+
+
+class Task:
+    def __init__(self, pf, name):
+        self.pf = pf
+        self.name = name
+        self.start = self.end = None
+        self.elapsed = 0.0
+        self.cpu = 0.0
+        self.read_bytes = 0
+        self.write_bytes = 0
+        self.maxrss = 0
+
+    def __str__(self):
+        return "%s:%s" % (self.pf, self.name)
+
+
+def recipe_name(pf):
+    match = PR_SUFFIX.match(pf)
+    return match.group(1) if match else pf
+
+
+def parse_task(path, pf, name):
+    task = Task(pf, name)
+    with open(path, errors="replace") as f:
+        for line in f:
+            key, sep, value = line.partition(":")
+            if not sep:
+                continue
+            value = value.split()
+            if not value:
+                continue
+            if key == "Started":
+                task.start = float(value[0])
+            elif key == "Ended":
+                task.end = float(value[0])
+            elif key == "Elapsed time":
+                task.elapsed = float(value[0])
+            elif key in ("rusage ru_utime", "rusage ru_stime",
+                         "Child rusage ru_utime", "Child rusage ru_stime"):
+                task.cpu += float(value[0])
+            elif key == "IO read_bytes":
+                task.read_bytes += int(value[0])
+            elif key == "IO write_bytes":
+                task.write_bytes += int(value[0])
+            elif key == "Child rusage ru_maxrss":
+                task.maxrss = int(value[0])
+    if task.start is None or task.end is None:
+        return None
+    return task
+
+
+def resolve(path):
+    entries = [e for e in os.listdir(path) if os.path.isdir(os.path.join(path, e))]
+    # A buildstats directory holds one directory per build, named by date;
+    # a build directory holds one per recipe plus the build_stats file.
+    if not os.path.exists(os.path.join(path, "build_stats")) and entries:
+        return os.path.join(path, sorted(entries)[-1])
+    return path
+
+
+def load(path, patterns):
+    path = resolve(path)
+    tasks = []
+    for pf in sorted(os.listdir(path)):
+        recipedir = os.path.join(path, pf)
+        if not os.path.isdir(recipedir):
+            continue
+        for name in sorted(os.listdir(recipedir)):
+            if not name.startswith("do_"):
+                continue
+            if patterns and not any(fnmatch.fnmatch(name, p) for p in patterns):
+                continue
+            task = parse_task(os.path.join(recipedir, name), pf, name)
+            if task:
+                tasks.append(task)
+    return path, tasks
+
+
+def load_depends(dotfile):
+    # "busybox.do_compile" [label="busybox do_compile\n:1.36.1-r0\n/path/busybox_1.36.1.bb"]
+    # "busybox.do_compile" -> "busybox.do_configure"
+    # The label holds "<epoch>:<pv>-<pr>" with an empty epoch by default, so
+    # an epoch reads "\n1:2.78-r0\n". The buildstats directory has it as
+    # "glib-2.0-1_2.78-r0" (EXTENDPE), so the epoch becomes "1_" here.
+    node = re.compile(r'^"([^"]+)\.(do_[^"]+)" \[label="[^\\]*\\n(\d+)?:([^\\]+)\\n')
+    edge = re.compile(r'^"([^"]+)" -> "([^"]+)"')
+    versions = {}
+    edges = []
+
+    def recipe(pn):
+        return pn.split(":", 2)[2] if pn.startswith("mc:") else pn
+
+    with open(dotfile) as f:
+        for line in f:
+            match = node.match(line)
+            if match:
+                epoch, version = match.group(3, 4)
+                if epoch and epoch != "0":
+                    version = "%s_%s" % (epoch, version)
+                versions[recipe(match.group(1))] = version
+                continue
+            match = edge.match(line)
+            if match:
+                edges.append((match.group(1), match.group(2)))
+
+    def key(tid):
+        pn, _, task = tid.rpartition(".")
+        pn = recipe(pn)
+        return "%s-%s:%s" % (pn, versions.get(pn, ""), task)
+
+    depends = {}
+    for task, dep in edges:
+        depends.setdefault(key(task), []).append(key(dep))
+    return depends
+
+
+def critical_path(tasks, depends):
+    by_id = {str(t): t for t in tasks}
+    by_end = sorted(tasks, key=lambda t: t.end)
+    current = by_end[-1]
+    path = [current]
+    while True:
+        if depends is not None:
+            candidates = [by_id[d] for d in depends.get(str(current), []) if d in by_id]
+        else:
+            candidates = [t for t in by_end if t.end <= current.start + 0.5 and t is not current]
+        if not candidates:
+            break
+        current = max(candidates, key=lambda t: t.end)
+        if current in path:
+            break
+        path.append(current)
+    path.reverse()
+    return path
+
+
+def recipes(tasks):
+    cost = {}
+    for task in tasks:
+        recipe = cost.setdefault(recipe_name(task.pf), [0.0, 0.0, 0, 0])
+        recipe[0] += task.elapsed
+        recipe[1] += task.cpu
+        recipe[2] += task.read_bytes
+        recipe[3] += task.write_bytes
+    return cost
+
+
+def mib(count):
+    return count / (1 << 20)
+
+
+def report(path, tasks, depends, top):
+    start = min(t.start for t in tasks)
+    end = max(t.end for t in tasks)
+    print("%s: %d tasks, %.0f s wall, %.0f s cpu" %
+          (path, len(tasks), end - start, sum(t.cpu for t in tasks)))
+
+    print("\ncritical path:")
+    print("%10s %10s  %s" % ("start", "elapsed", "task"))
+    for task in critical_path(tasks, depends):
+        print("%10.1f %10.1f  %s" % (task.start - start, task.elapsed, task))
+
+    print("\nrecipes by elapsed task time:")
+    print("%10s %10s %12s %12s  %s" % ("elapsed", "cpu", "read MiB", "write MiB", "recipe"))
+    cost = recipes(tasks)
+    for name in sorted(cost, key=lambda n: cost[n][0], reverse=True)[:top]:
+        elapsed, cpu, read, write = cost[name]
+        print("%10.1f %10.1f %12.1f %12.1f  %s" % (elapsed, cpu, mib(read), mib(write), name))
+
+
+def tail(path, tasks):
+    """Print the tasks after the last do_rootfs, return the tail's wall time."""
+    rootfs = [t.end for t in tasks if t.name == "do_rootfs"]
+    if not rootfs:
+        print("%s: no do_rootfs, nothing to report" % path, file=sys.stderr)
+        return None
+    cut = max(rootfs)
+    end = max(t.end for t in tasks)
+    after = sorted((t for t in tasks if t.end > cut), key=lambda t: t.start)
+    busy = sum(t.end - max(t.start, cut) for t in after)
+    wall = end - cut
+    print("%s: %.0f s after the last do_rootfs, %d tasks, %.1f running at once" %
+          (path, wall, len(after), busy / wall if wall else 0))
+
+    def line(task):
+        start = max(task.start, cut)
+        print("%10.1f %10.1f  %s" % (start - cut, task.end - start, task))
+
+    print("%10s %10s  %s" % ("start", "elapsed", "task"))
+    for task in after:
+        line(task)
+    print("\nheld up by:")
+    for task in critical_path(after, None):
+        line(task)
+    return wall
+
+
+def diff(old, new, top):
+    before = recipes(old)
+    after = recipes(new)
+    names = set(before) | set(after)
+    zero = [0.0, 0.0, 0, 0]
+    change = {n: after.get(n, zero)[0] - before.get(n, zero)[0] for n in names}
+    print("%10s %10s %10s %10s  %s" % ("old", "new", "delta", "cpu delta", "recipe"))
+    for name in sorted(names, key=lambda n: abs(change[n]), reverse=True)[:top]:
+        old_cost = before.get(name, zero)
+        new_cost = after.get(name, zero)
+        print("%10.1f %10.1f %+10.1f %+10.1f  %s" %
+              (old_cost[0], new_cost[0], change[name], new_cost[1] - old_cost[1], name))
+    print("%10.1f %10.1f %+10.1f %10s  total" %
+          (sum(c[0] for c in before.values()), sum(c[0] for c in after.values()),
+           sum(change.values()), ""))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Report critical path and per-recipe cost from buildstats")
+    parser.add_argument("buildstats")
+    parser.add_argument("new", nargs="?")
+    parser.add_argument("--depends")
+    parser.add_argument("--tasks", default="")
+    parser.add_argument("--top", type=int, default=20)
+    parser.add_argument("--tail", action="store_true")
+    args = parser.parse_args()
+
+    patterns = [p for p in args.tasks.split(",") if p]
+    path, tasks = load(args.buildstats, patterns)
+    if not tasks:
+        print("%s: no task statistics found" % path, file=sys.stderr)
+        return 1
+
+    if args.tail:
+        walls = [tail(path, tasks)]
+        if args.new:
+            print()
+            walls.append(tail(*load(args.new, patterns)))
+            if None not in walls:
+                print("\ntail: %.0f s before, %.0f s after, %+.0f s" %
+                      (walls[0], walls[1], walls[1] - walls[0]))
+        return 1 if None in walls else 0
+
+    if args.new:
+        _, new_tasks = load(args.new, patterns)
+        diff(tasks, new_tasks, args.top)
+    else:
+        depends = load_depends(args.depends) if args.depends else None
+        report(path, tasks, depends, args.top)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
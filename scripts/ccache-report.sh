@@ -0,0 +1,90 @@
+#!/bin/sh
+#
+# Print the ccache hit rate per recipe and in total, followed by the compile
+# time of the ten slowest recipes of a build. Pass a second buildstats
+# directory to compare their rebuild time before and after.
+#
+# ccache counters add up over every build that ever used the cache, which is
+# shared by all build directories on the host. To count one build only,
+# save the counters before it and report the difference afterwards:
+#
+#   scripts/ccache-report.sh --save <counters> <ccache-dir>
+#   kas build ...
+#   scripts/ccache-report.sh --since <counters> <ccache-dir> <buildstats>
+#
+# usage: scripts/ccache-report.sh [--since <counters>] <ccache-dir> <buildstats> [<new-buildstats>]
+#        scripts/ccache-report.sh --save <counters> <ccache-dir>
+
+set -e
+
+usage() {
+    echo "usage: $0 [--since <counters>] <ccache-dir> <buildstats> [<new-buildstats>]" >&2
+    echo "       $0 --save <counters> <ccache-dir>" >&2
+    exit 1
+}
+
+save=""
+since=""
+case "$1" in
+--save|--since)
+    [ $# -ge 2 ] || usage
+    [ "$1" = --save ] && save="$2" || since="$2"
+    shift 2
+    ;;
+esac
+ccachedir="$1"
+if [ -z "${ccachedir}" ] || { [ -z "${save}" ] && [ -z "$2" ]; }; then
+    usage
+fi
+shift
+if [ -n "${since}" ] && [ ! -r "${since}" ]; then
+    echo "${since}: no saved counters, run with --save before the build" >&2
+    exit 1
+fi
+
+# "<target-sys>/<recipe> <hits> <misses>" for each cache below
+# CCACHE_TOP_DIR/<target-sys>/<recipe>
+counters() {
+    find "${ccachedir}" -mindepth 2 -maxdepth 2 -type d | sort | while read -r dir; do
+        ccache --dir "${dir}" --print-stats |
+            awk -v r="$(basename "$(dirname "${dir}")")/$(basename "${dir}")" '
+                { v[$1] = $2 }
+                END { print r, v["direct_cache_hit"] + v["preprocessed_cache_hit"], v["cache_miss"] }'
+    done
+}
+
+if [ -n "${save}" ]; then
+    counters >"${save}"
+    exit 0
+fi
+
+# Subtract the saved counters; recipes that did not compile anything since
+# are left out
+counters | awk -v since="${since}" '
+    BEGIN {
+        while (since != "" && (getline line <since) > 0) {
+            split(line, f, " ")
+            hits[f[1]] = f[2]
+            misses[f[1]] = f[3]
+        }
+    }
+    {
+        h = $2 - hits[$1]
+        m = $3 - misses[$1]
+        if (since == "" || h + m)
+            print $1, h, m
+    }' | awk '
+    {
+        total = $2 + $3
+        printf "%-56s hits %8d  misses %8d  hit rate %5.1f%%\n", $1, $2, $3, total ? 100 * $2 / total : 0
+        hits += $2
+        misses += $3
+    }
+    END {
+        total = hits + misses
+        printf "%-56s hits %8d  misses %8d  hit rate %5.1f%%\n", "total", hits, misses, total ? 100 * hits / total : 0
+    }'
+
+echo
+exec "$(dirname "$0")/buildstats-report.py" --top 10 \
+    --tasks "do_configure,do_compile,do_compile_kernelmodules" "$@"
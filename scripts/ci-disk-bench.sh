@@ -0,0 +1,65 @@
+#!/bin/sh
+#
+# Compare disk writes, peak TMPDIR usage and wall time of the default build
+# layout with kas/include/ci-tmpfs.yml.
+#
+# Writes are the sectors written to the block device holding <work-dir>,
+# so run it on an otherwise idle disk.
+#
+# usage: scripts/ci-disk-bench.sh <work-dir> [kas-file]
+
+set -e
+
+. "$(dirname "$0")/lib/bench.sh"
+
+config="${2:-kas/jetson-orin-nano-devkit-nvme.yml}"
+if [ -z "$1" ]; then
+    echo "usage: $0 <work-dir> [kas-file]" >&2
+    exit 1
+fi
+bench_workdir "$1"
+
+device=$(basename "$(df --output=source "${workdir}" | tail -n 1)")
+if [ ! -e "/sys/class/block/${device}/stat" ]; then
+    echo "cannot find block statistics for ${device}" >&2
+    exit 1
+fi
+
+written_mib() {
+    awk '{ print int($7 * 512 / 1048576) }' "/sys/class/block/${device}/stat"
+}
+
+used_mib() {
+    df --output=used -m "${workdir}" | tail -n 1 | tr -d ' '
+}
+
+sample_usage() {
+    base=$(used_mib)
+    peak=0
+    while [ ! -e "$1.done" ]; do
+        used=$(($(used_mib) - base))
+        [ "${used}" -gt "${peak}" ] && peak=${used}
+        sleep 5
+    done
+    echo "${peak}" >"$1.peak"
+}
+
+bench_start() {
+    rm -f "$1.peak"
+    sync
+    sample_usage "$1" &
+    before=$(written_mib)
+}
+
+bench_stop() {
+    sync
+    after=$(written_mib)
+    wait
+    printf "%-8s %8s s %10s MiB %10s MiB  %s\n" "$(basename "$1")" \
+        "${build_seconds}" $((after - before)) "$(cat "$1.peak")" "${build_status}"
+}
+
+echo "device: ${device}"
+printf "%-8s %10s %14s %14s\n" "layout" "wall" "written" "peak used"
+timed_build "${workdir}/default" "${config}"
+timed_build "${workdir}/ci" "${config}:kas/include/ci-tmpfs.yml"
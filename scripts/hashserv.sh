@@ -0,0 +1,20 @@
+#!/bin/sh
+#
+# Run the persistent hash equivalence server used by
+# kas/include/shared-cache.yml. The database lives next to the shared
+# sstate so both survive together.
+#
+# usage: scripts/hashserv.sh [cache-dir] [bind-address]
+
+cachedir="${1:-/srv/skytrack-cache}"
+bind="${2:-0.0.0.0:8686}"
+bitbake="$(dirname "$0")/../repos/bitbake"
+
+if [ ! -x "${bitbake}/bin/bitbake-hashserv" ]; then
+    echo "bitbake not found in ${bitbake}, run kas checkout first" >&2
+    exit 1
+fi
+
+mkdir -p "${cachedir}"
+exec "${bitbake}/bin/bitbake-hashserv" --bind "${bind}" \
+    --database "${cachedir}/hashserv.db" --log INFO
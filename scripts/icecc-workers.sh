@@ -0,0 +1,43 @@
+#!/bin/sh
+#
+# Start an icecream scheduler and compile workers as local containers for
+# kas/include/icecc.yml. The scheduler port is published on the host, where
+# iceccd has to run and connect to it:
+#
+#   iceccd -d -s localhost
+#
+# usage: scripts/icecc-workers.sh start [workers] [cores-per-worker]
+#        scripts/icecc-workers.sh stop
+
+set -e
+
+network=skytrack-icecc
+image=debian:bookworm
+install="apt-get update -qq && apt-get install -y -qq icecc >/dev/null"
+
+case "$1" in
+start)
+    workers="${2:-4}"
+    cores="${3:-4}"
+    docker network inspect "${network}" >/dev/null 2>&1 || docker network create "${network}" >/dev/null
+    docker run -d --rm --name skytrack-icecc-scheduler --network "${network}" \
+        -p 8765:8765 -p 8766:8766 "${image}" \
+        sh -c "${install} && exec icecc-scheduler -vv" >/dev/null
+    i=1
+    while [ "${i}" -le "${workers}" ]; do
+        docker run -d --rm --name "skytrack-icecc-worker${i}" --network "${network}" \
+            --cpus "${cores}" "${image}" \
+            sh -c "${install} && exec iceccd -vv -s skytrack-icecc-scheduler -m ${cores}" >/dev/null
+        i=$((i + 1))
+    done
+    echo "started scheduler and ${workers} workers with ${cores} cores each"
+    ;;
+stop)
+    docker ps -q --filter "name=skytrack-icecc-" | xargs -r docker stop >/dev/null
+    docker network rm "${network}" >/dev/null 2>&1 || true
+    ;;
+*)
+    echo "usage: $0 start [workers] [cores-per-worker] | stop" >&2
+    exit 1
+    ;;
+esac
@@ -0,0 +1,22 @@
+#!/bin/sh
+#
+# List the size of every rootfs and update artifact of an image in a deploy
+# directory, to compare rootfs formats (for example ext4 against
+# erofs-lz4hc) between two builds.
+#
+# usage: scripts/image-size-report.sh <deploy-dir> [image-name]
+
+deploydir="$1"
+image="${2:-demo-image-base-jetson-orin-nano-devkit-nvme}"
+if [ ! -d "${deploydir}" ]; then
+    echo "usage: $0 <deploy-dir> [image-name]" >&2
+    exit 1
+fi
+
+printf "%-60s %14s\n" "artifact" "bytes"
+for f in "${deploydir}/${image}".* "${deploydir}"/swupdate-image-skytrack*.swu; do
+    [ -e "${f}" ] || continue
+    # Only the stable link names, not the timestamped duplicates
+    [ -L "${f}" ] || continue
+    printf "%-60s %14s\n" "$(basename "${f}")" "$(stat -L -c %s "${f}")"
+done
@@ -0,0 +1,44 @@
+#!/bin/sh
+#
+# Time the end of a build: the image conversions, the tegraflash archive and
+# the .swu images. In an already built directory, <image> is rebuilt from
+# do_image on ("bitbake -C image") together with the given .swu targets in
+# one BitBake run, so the independent artifacts are built concurrently as
+# in a full build. buildstats-report.py --tail then shows how long the tail
+# took, how many of its tasks ran at once and which chain held it up.
+#
+# Pass the buildstats of an earlier build to compare the tail with it.
+#
+# usage: scripts/image-tail-bench.sh [--old <buildstats>] <kas-file> <image> [<target>...]
+#   e.g. scripts/image-tail-bench.sh kas/jetson-orin-nano-devkit-nvme.yml \
+#            core-image-full-cmdline swupdate-image-tegra \
+#            swupdate-image-skytrack swupdate-image-skytrack-full
+
+set -e
+
+old=""
+if [ "$1" = --old ]; then
+    old="$2"
+    shift 2
+fi
+config="$1"
+image="$2"
+if [ -z "${config}" ] || [ -z "${image}" ]; then
+    echo "usage: $0 [--old <buildstats>] <kas-file> <image> [<target>...]" >&2
+    exit 1
+fi
+shift 2
+builddir="${KAS_BUILD_DIR:-build}"
+
+# Build everything first, so only the tail runs below
+kas build "${config}" >/dev/null
+
+start=$(date +%s)
+# The .swu targets have no do_image; bitbake only warns about them
+kas shell "${config}" -c "bitbake -C image ${image} $*" >/dev/null
+end=$(date +%s)
+stats=$(ls -d "${builddir}"/tmp*/buildstats/* | sort | tail -n 1)
+
+echo "tail rebuilt in $((end - start)) s"
+echo
+exec "$(dirname "$0")/buildstats-report.py" --tail ${old:+"${old}"} "${stats}"
@@ -0,0 +1,40 @@
+# Shared by the build benchmarks in scripts/, sourced with
+#   . "$(dirname "$0")/lib/bench.sh"
+#
+# Every build starts from an empty build directory; downloads are shared
+# through DL_DIR so the network does not skew the result.
+
+# bench_workdir <work-dir>: create it, set ${workdir} to its absolute path
+# and share downloads below it.
+bench_workdir() {
+    mkdir -p "$1"
+    workdir="$(cd "$1" && pwd)"
+    export DL_DIR="${workdir}/downloads"
+}
+
+# Called around each build with the build directory; override them to
+# sample the host while kas runs. <build-dir>.done appears when the build
+# has finished.
+bench_start() {
+    :
+}
+
+bench_stop() {
+    :
+}
+
+# timed_build <build-dir> <kas-file>...: build from scratch, log to
+# <build-dir>.log and set ${build_seconds} and ${build_status} (ok/failed).
+timed_build() {
+    builddir="$1"
+    shift
+    rm -rf "${builddir}" "${builddir}.done"
+    bench_start "${builddir}"
+    start=$(date +%s)
+    build_status=ok
+    KAS_BUILD_DIR="${builddir}" kas build "$@" >"${builddir}.log" 2>&1 || build_status=failed
+    end=$(date +%s)
+    build_seconds=$((end - start))
+    touch "${builddir}.done"
+    bench_stop "${builddir}"
+}
@@ -0,0 +1,61 @@
+#!/bin/sh
+#
+# Fetch every source needed by the targets of a kas configuration and copy
+# the downloads into the offline mirror used by kas/include/offline-mirror.yml.
+# Only do_fetch runs, so this is much faster than a build. Run it once per
+# kas configuration; the mirror is shared between them.
+#
+# The layer repositories kas checked out are mirrored below <mirror-dir>/git,
+# and <mirror-dir>/kas-premirrors maps their URLs there for KAS_PREMIRRORS,
+# so kas can clone them without network access too.
+#
+# usage: scripts/mirror-sync.sh <mirror-dir> [kas-file]
+
+set -e
+
+mirror="$1"
+config="${2:-kas/jetson-orin-nano-devkit-nvme.yml}"
+if [ -z "${mirror}" ]; then
+    echo "usage: $0 <mirror-dir> [kas-file]" >&2
+    exit 1
+fi
+mkdir -p "${mirror}"
+mirror="$(cd "${mirror}" && pwd)"
+
+SKYTRACK_MIRROR_DIR="${mirror}" kas build \
+    "${config}:kas/include/mirror-generate.yml" -- --runall=fetch
+
+# Tarballs and plain downloads only: no git clones, stamps or locks.
+downloads="$(kas shell "${config}" -c "bitbake-getvar --value DL_DIR" | tail -n 1)"
+find "${downloads}" -maxdepth 1 -type f \
+    ! -name '*.done' ! -name '*.lock' ! -name '*.tmp' \
+    -exec cp -u {} "${mirror}/" \;
+
+# uninative.bbclass keeps its tarball in DL_DIR/uninative/<sha256>/ and
+# looks it up below the same path on each PREMIRRORS entry.
+find "${downloads}/uninative" -mindepth 2 -maxdepth 2 -type f \
+    ! -name '*.done' ! -name '*.lock' ! -name '*.tmp' 2>/dev/null |
+    while read -r file; do
+        dir="${mirror}/uninative/$(basename "$(dirname "${file}")")"
+        mkdir -p "${dir}"
+        cp -u "${file}" "${dir}/"
+    done
+
+# Layer repositories: one bare mirror per remote, and a KAS_PREMIRRORS line
+# matching exactly its URL
+for repo in "${KAS_WORK_DIR:-$(pwd)}"/repos/*/; do
+    url="$(git -C "${repo}" remote get-url origin 2>/dev/null)" || continue
+    dest="${mirror}/git/$(basename "${repo}").git"
+    if [ -d "${dest}" ]; then
+        git -C "${dest}" remote update --prune >/dev/null
+    else
+        git clone -q --mirror "${url}" "${dest}"
+    fi
+    printf '^%s$ %s\n' "$(printf '%s' "${url}" | sed 's/[].[\\*^$()+?{}|]/\\&/g')" "${dest}"
+done >"${mirror}/kas-premirrors.new"
+cat "${mirror}/kas-premirrors" "${mirror}/kas-premirrors.new" 2>/dev/null | sort -u >"${mirror}/kas-premirrors.tmp"
+mv "${mirror}/kas-premirrors.tmp" "${mirror}/kas-premirrors"
+rm "${mirror}/kas-premirrors.new"
+
+echo "$(find "${mirror}" -path "${mirror}/git" -prune -o -type f ! -name kas-premirrors -print | wc -l) files" \
+    "and $(wc -l <"${mirror}/kas-premirrors") layer repositories in ${mirror}"
@@ -0,0 +1,29 @@
+#!/bin/sh
+#
+# Compare the wall time of the two product builds run one after the other,
+# each in its own build directory as before, with the combined multiconfig
+# build in a single directory.
+#
+# usage: scripts/multiconfig-bench.sh <work-dir>
+
+set -e
+
+. "$(dirname "$0")/lib/bench.sh"
+
+if [ -z "$1" ]; then
+    echo "usage: $0 <work-dir>" >&2
+    exit 1
+fi
+bench_workdir "$1"
+
+report() {
+    timed_build "${workdir}/build-$1" "$2"
+    printf "%-24s %8s s  %s\n" "$1" "${build_seconds}" "${build_status}"
+}
+
+printf "%-24s %10s\n" "build" "wall"
+report jetson kas/jetson-orin-nano-devkit-nvme.yml
+jetson=${build_seconds}
+report rpi5 kas/raspberrypi5.yml
+printf "%-24s %8s s\n" "sequential total" "$((jetson + build_seconds))"
+report multiconfig kas/multiconfig.yml
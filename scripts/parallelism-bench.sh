@@ -0,0 +1,55 @@
+#!/bin/sh
+#
+# Compare the pinned job counts with host-derived parallelism and pressure
+# regulation on this host. Run it on each host size of interest (a laptop
+# and a CI runner) and compare the tables.
+#
+# Peak memory and swap are sampled from /proc/meminfo once per second.
+#
+# usage: scripts/parallelism-bench.sh <work-dir> [kas-file]
+
+set -e
+
+. "$(dirname "$0")/lib/bench.sh"
+
+config="${2:-kas/jetson-orin-nano-devkit-nvme.yml}"
+if [ -z "$1" ]; then
+    echo "usage: $0 <work-dir> [kas-file]" >&2
+    exit 1
+fi
+bench_workdir "$1"
+
+meminfo() {
+    awk -v key="$1" '$1 == key ":" { print int($2 / 1024) }' /proc/meminfo
+}
+
+sample_memory() {
+    total=$(meminfo MemTotal)
+    swap_total=$(meminfo SwapTotal)
+    peak_used=0
+    peak_swap=0
+    while [ ! -e "$1.done" ]; do
+        used=$((total - $(meminfo MemAvailable)))
+        swap=$((swap_total - $(meminfo SwapFree)))
+        [ "${used}" -gt "${peak_used}" ] && peak_used=${used}
+        [ "${swap}" -gt "${peak_swap}" ] && peak_swap=${swap}
+        sleep 1
+    done
+    echo "${peak_used} ${peak_swap}" >"$1.mem"
+}
+
+bench_start() {
+    rm -f "$1.mem"
+    sample_memory "$1" &
+}
+
+bench_stop() {
+    wait
+    printf "%-8s %8s s %8s MiB %8s MiB  %s\n" "$(basename "$1")" \
+        "${build_seconds}" $(cat "$1.mem") "${build_status}"
+}
+
+echo "host: $(nproc) cores, $(meminfo MemTotal) MiB memory, $(meminfo SwapTotal) MiB swap"
+printf "%-8s %10s %12s %12s\n" "mode" "wall" "peak mem" "peak swap"
+timed_build "${workdir}/pinned" "${config}:kas/include/pinned-parallelism.yml"
+timed_build "${workdir}/host" "${config}"
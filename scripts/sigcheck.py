@@ -0,0 +1,136 @@
+#!/usr/bin/env python3
+#
+# Check that native and allarch tasks hash the same for the Jetson and the
+# RPi5 multiconfig, so one machine can reuse the other's sstate.
+#
+# Writes the task signatures of both images without building anything
+# ("bitbake -S none"), then compares the native and allarch stamps of
+# tmp-jetson and tmp-rpi5. For every task whose hash differs,
+# bitbake-diffsigs shows which variable or dependency caused it. Having no
+# allarch task in common counts as a failure as well.
+#
+# With --single, every task of each machine in the multiconfig build is
+# compared with the same machine's single-machine build instead, in
+# <build-dir>-jetson and <build-dir>-rpi5. Both machines parse every
+# product layer in the combined build, so this shows whether a bbappend or
+# setting of one machine leaks into the other. Tasks that only one of the
+# two builds has, such as the recipes of a layer the machine should not
+# see, count as differences too.
+#
+# usage: scripts/sigcheck.py [--no-dump] [--single] [--max-diffs N] [build-dir]
+
+import argparse
+import glob
+import os
+import re
+import subprocess
+import sys
+
+TOPDIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..")
+# multiconfig: (single-machine kas file, image)
+MACHINES = {
+    "jetson": ("kas/jetson-orin-nano-devkit-nvme.yml", "swupdate-image-tegra"),
+    "rpi5": ("kas/raspberrypi5.yml", "core-image-base"),
+}
+SIGDATA = re.compile(r"^(.*)\.sigdata\.([0-9a-f]+)$")
+
+
+def dump(builddir, config, targets):
+    env = dict(os.environ, KAS_BUILD_DIR=builddir)
+    subprocess.run(["kas", "shell", config, "-c", "bitbake -S none %s" % " ".join(targets)],
+                   cwd=TOPDIR, env=env, check=True)
+
+
+def signatures(tmpdir, everything=False):
+    # stamps/<arch>/<recipe>/<pv-pr>.<task>.sigdata.<hash>, newest wins
+    sigs = {}
+    for arch in glob.glob(os.path.join(tmpdir, "stamps", "*")):
+        # x86_64-linux holds native and cross, all-skytrack-linux allarch
+        name = os.path.basename(arch)
+        if not everything and name.count("-") != 1 and not name.startswith("all-"):
+            continue
+        for path in sorted(glob.glob(os.path.join(arch, "*", "*.sigdata.*")), key=os.path.getmtime):
+            match = SIGDATA.match(os.path.basename(path))
+            if match:
+                # Key allarch tasks without the vendor, so a machine with
+                # another TARGET_VENDOR shows up as differing tasks instead
+                # of none in common
+                arch = "all" if name.startswith("all-") else name
+                key = os.path.join(arch, os.path.basename(os.path.dirname(path)), match.group(1))
+                sigs[key] = (match.group(2), path)
+    return sigs
+
+
+def compare(a, b, what, max_diffs, names=None):
+    """Print the tasks whose hash differs between two signature sets, return their number.
+
+    With names, the tasks only one of the sets has are listed and counted
+    as well, named after the set they are in.
+    """
+    common = sorted(set(a) & set(b))
+    if not common:
+        print("no common %s signatures" % what, file=sys.stderr)
+        return -1
+
+    differ = [key for key in common if a[key][0] != b[key][0]]
+    print("%d %s tasks in both, %d differ" % (len(common), what, len(differ)))
+    missing = 0
+    for name, these, other in zip(names or (), (a, b), (b, a)):
+        only = sorted(set(these) - set(other))
+        missing += len(only)
+        if only:
+            print("%d tasks only in the %s build:" % (len(only), name))
+            for key in only[:max_diffs]:
+                print("    %s" % key)
+            if len(only) > max_diffs:
+                print("    ... %d more" % (len(only) - max_diffs))
+
+    diffsigs = os.path.join(TOPDIR, "repos", "bitbake", "bin", "bitbake-diffsigs")
+    if differ and not os.path.exists(diffsigs):
+        print("bitbake not found in %s, run kas checkout first" % os.path.dirname(diffsigs), file=sys.stderr)
+        return len(differ) + missing
+    for key in differ[:max_diffs]:
+        print("\n%s" % key)
+        subprocess.run([diffsigs, a[key][1], b[key][1]])
+    if len(differ) > max_diffs:
+        print("\n... %d more" % (len(differ) - max_diffs))
+    return len(differ) + missing
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compare native and allarch task signatures across machines")
+    parser.add_argument("builddir", nargs="?", default=os.path.join(TOPDIR, "build"))
+    parser.add_argument("--no-dump", action="store_true", help="use the signatures already in the build directory")
+    parser.add_argument("--single", action="store_true",
+                        help="compare each machine with its single-machine build")
+    parser.add_argument("--max-diffs", type=int, default=10)
+    args = parser.parse_args()
+
+    builddir = os.path.abspath(args.builddir)
+    if not args.no_dump:
+        dump(builddir, "kas/multiconfig.yml",
+             ["mc:%s:%s" % (mc, image) for mc, (_, image) in sorted(MACHINES.items())])
+        if args.single:
+            for mc, (config, image) in sorted(MACHINES.items()):
+                dump("%s-%s" % (builddir, mc), config, [image])
+
+    if args.single:
+        failed = 0
+        for mc in sorted(MACHINES):
+            print("%s: multiconfig against single-machine build" % mc)
+            combined = signatures(os.path.join(builddir, "tmp-%s" % mc), everything=True)
+            single = signatures(os.path.join("%s-%s" % (builddir, mc), "tmp"), everything=True)
+            failed += compare(combined, single, mc, args.max_diffs, ("multiconfig", "single-machine")) != 0
+        return 1 if failed else 0
+
+    jetson = signatures(os.path.join(builddir, "tmp-jetson"))
+    rpi5 = signatures(os.path.join(builddir, "tmp-rpi5"))
+    failed = compare(jetson, rpi5, "native/allarch", args.max_diffs) != 0
+    if not any(key.startswith("all/") for key in set(jetson) & set(rpi5)):
+        print("no allarch task in both machines, they cannot share allarch sstate", file=sys.stderr)
+        failed = True
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,52 @@
+#!/bin/sh
+#
+# Print the sstate hit rate of the last build in a build directory.
+#
+# The "Sstate summary" of the bitbake log covers the whole run. In a
+# multiconfig build there is one such log for all machines, so each TMPDIR
+# (tmp-jetson, tmp-rpi5, ...) is also counted separately from its newest
+# buildstats: tasks restored from sstate ran as *_setscene, the ones that
+# missed ran as the real task.
+#
+# usage: scripts/sstate-report.sh [build-dir]
+
+builddir="${1:-build}"
+
+# Tasks whose output goes into sstate
+SSTATE_TASKS="do_populate_sysroot do_populate_lic do_package do_packagedata do_package_qa
+do_package_write_ipk do_package_write_rpm do_package_write_deb do_deploy do_create_spdx
+do_deploy_source_date_epoch do_shared_workdir do_image_complete"
+
+found=0
+for log in "${builddir}"/tmp*/log/cooker/*/console-latest.log; do
+    [ -e "${log}" ] || continue
+    found=1
+    sed -n 's/.*Sstate summary: //p' "${log}" | tail -n 1 | awk -v m="all (bitbake summary)" '
+        {
+            for (i = 1; i < NF; i += 2) v[$i] = $(i + 1)
+            printf "%-32s wanted %6d  local %6d  mirrors %6d  missed %6d  current %6d  hit rate %5.1f%%\n",
+                m, v["Wanted"], v["Local"], v["Mirrors"], v["Missed"], v["Current"],
+                v["Wanted"] ? 100 * (v["Wanted"] - v["Missed"]) / v["Wanted"] : 100
+        }'
+done
+
+for tmpdir in "${builddir}"/tmp*; do
+    last=$(ls -td "${tmpdir}"/buildstats/*/ 2>/dev/null | head -n 1)
+    [ -n "${last}" ] || continue
+    found=1
+    # buildstats/<time>/<recipe>/<task>, one file per task that ran
+    ls "${last}"*/ | awk -v m="$(basename "${tmpdir}")" -v tasks="${SSTATE_TASKS}" '
+        BEGIN { n = split(tasks, t); for (i = 1; i <= n; i++) sstate[t[i]] = 1 }
+        /_setscene$/ { restored++; next }
+        $0 in sstate { missed++ }
+        END {
+            total = restored + missed
+            printf "%-32s restored %6d  missed %6d  hit rate %5.1f%%\n",
+                m, restored, missed, total ? 100 * restored / total : 100
+        }'
+done
+
+if [ "${found}" -eq 0 ]; then
+    echo "no cooker logs or buildstats under ${builddir}" >&2
+    exit 1
+fi
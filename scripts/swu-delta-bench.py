@@ -0,0 +1,64 @@
+#!/usr/bin/env python3
+#
+# Measure what a seeded delta install transfers compared to a full one.
+#
+# Both rootfs images are chunked the way the build does it. The new .zck is
+# served over HTTP and fetched with zckdl seeded from the old release, the
+# same reconstruction the skytrack_delta handler does from the active slot:
+# matching chunks are copied locally and only the missing ones are
+# requested. Reports bytes transferred and wall time for both cases.
+#
+# usage: scripts/swu-delta-bench.py old.rootfs.ext4 new.rootfs.ext4
+
+import os
+import subprocess
+import sys
+import tempfile
+import time
+
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), "..", "meta-test", "lib"))
+from skytrack import rangeserver
+
+
+def zck(image, output):
+    subprocess.run(["zck", "--output", output, "-u", "--chunk-hash-type", "sha256", image],
+                   check=True, stdout=subprocess.DEVNULL)
+
+
+def fetch(url, workdir, source=None):
+    cmd = ["zckdl"]
+    if source:
+        cmd += ["--source", source]
+    start = time.monotonic()
+    subprocess.run(cmd + [url], cwd=workdir, check=True, stdout=subprocess.DEVNULL)
+    return time.monotonic() - start
+
+
+def main():
+    if len(sys.argv) != 3:
+        print("usage: %s old.rootfs.ext4 new.rootfs.ext4" % sys.argv[0], file=sys.stderr)
+        return 1
+
+    with tempfile.TemporaryDirectory() as workdir:
+        old = os.path.join(workdir, "old.zck")
+        new = os.path.join(workdir, "new.zck")
+        zck(sys.argv[1], old)
+        zck(sys.argv[2], new)
+        with open(new, "rb") as f:
+            server, handler = rangeserver.serve({"/new.zck": f.read()})
+        url = "http://127.0.0.1:%d/new.zck" % server.server_address[1]
+
+        print("%-8s %14s %10s %8s" % ("install", "bytes", "requests", "seconds"))
+        for name, source in (("full", None), ("delta", old)):
+            handler.requests = handler.sent = 0
+            fetchdir = os.path.join(workdir, name)
+            os.mkdir(fetchdir)
+            seconds = fetch(url, fetchdir, source)
+            print("%-8s %14d %10d %8.2f" % (name, handler.sent, handler.requests, seconds))
+
+        server.shutdown()
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,38 @@
+#!/bin/sh
+#
+# Report how much a delta update downloads between successive releases.
+#
+# Pass the rootfs .ext4 images of the releases, oldest first. Each image is
+# chunked the same way the build does it, and for every consecutive pair
+# the script prints the full size, the bytes the delta handler would fetch
+# and the time zck took.
+#
+# usage: scripts/swu-delta-report.sh release1.ext4 release2.ext4 [...]
+
+set -e
+
+if [ "$#" -lt 2 ]; then
+    echo "usage: $0 release1.ext4 release2.ext4 [...]" >&2
+    exit 1
+fi
+
+workdir="$(mktemp -d)"
+trap 'rm -rf "${workdir}"' EXIT
+
+i=0
+previous=""
+for image in "$@"; do
+    i=$((i + 1))
+    start=$(date +%s)
+    zck --output "${workdir}/${i}.zck" -u --chunk-hash-type sha256 "${image}"
+    end=$(date +%s)
+
+    echo "== ${image}"
+    echo "image bytes:  $(stat -L -c %s "${image}")"
+    echo "zck bytes:    $(stat -c %s "${workdir}/${i}.zck")"
+    echo "zck seconds:  $((end - start))"
+    if [ -n "${previous}" ]; then
+        zck_delta_size "${previous}" "${workdir}/${i}.zck"
+    fi
+    previous="${workdir}/${i}.zck"
+done
@@ -0,0 +1,85 @@
+#!/bin/sh
+#
+# Time real "swupdate -i" installs of the raw rootfs into a loop device
+# standing in for the inactive slot:
+#   raw           SWUpdate's raw handler with compressed = "zstd", one
+#                 decompression thread, writes through the page cache
+#   skytrack_raw  the skytrack handler: pzstd on all cores, O_DIRECT writes
+#
+# Run it as root on a target whose swupdate has the skytrack handler, built
+# without swupdate-signing.yml so unsigned .swu files are accepted. Copy the
+# .pzst rootfs from the deploy directory to the target first; the single
+# frame .zst for the raw handler is made from it.
+#
+# usage: scripts/swu-install-bench.sh <rootfs.pzst>
+
+set -e
+
+pzst="$1"
+if [ ! -r "${pzst}" ]; then
+    echo "usage: $0 <rootfs.pzst>" >&2
+    exit 1
+fi
+
+workdir="$(mktemp -d)"
+loop=""
+cleanup() {
+    [ -n "${loop}" ] && losetup -d "${loop}"
+    rm -rf "${workdir}"
+}
+trap cleanup EXIT
+
+cp "${pzst}" "${workdir}/rootfs.pzst"
+pzstd -d -q -c "${workdir}/rootfs.pzst" | zstd -q -T0 -c >"${workdir}/rootfs.zst"
+size=$(pzstd -d -q -c "${workdir}/rootfs.pzst" | wc -c)
+
+# A slot the size of the raw rootfs
+truncate -s "${size}" "${workdir}/slot.img"
+loop=$(losetup --find --show "${workdir}/slot.img")
+
+# swu <name> <file> <sw-description image attributes>
+swu() {
+    mkdir -p "${workdir}/$1"
+    cat >"${workdir}/$1/sw-description" <<EOF
+software =
+{
+    version = "0";
+    images: (
+        {
+            filename = "$2";
+            device = "${loop}";
+            installed-directly = true;
+            sha256 = "$(sha256sum "${workdir}/$2" | cut -d' ' -f1)";
+            $3
+        }
+    );
+}
+EOF
+    ln -f "${workdir}/$2" "${workdir}/$1/$2"
+    (cd "${workdir}/$1" && printf '%s\n' sw-description "$2" | cpio -o -H newc) \
+        >"${workdir}/$1.swu" 2>/dev/null
+}
+
+swu raw rootfs.zst 'type = "raw"; compressed = "zstd";'
+swu skytrack_raw rootfs.pzst 'type = "skytrack_raw";'
+
+printf "%-14s %10s %10s %10s %10s\n" "handler" "wall s" "MiB/s" "user s" "sys s"
+for handler in raw skytrack_raw; do
+    dd if=/dev/zero of="${loop}" bs=4M count=1 status=none
+    sync
+    echo 3 >/proc/sys/vm/drop_caches
+    # user and system time of the shell's waited-for children, in clock ticks
+    before=$(awk '{ print $16, $17 }' /proc/$$/stat)
+    start=$(date +%s.%N)
+    swupdate -i "${workdir}/${handler}.swu" >"${workdir}/${handler}.log" 2>&1 ||
+        { cat "${workdir}/${handler}.log" >&2; exit 1; }
+    sync
+    end=$(date +%s.%N)
+    after=$(awk '{ print $16, $17 }' /proc/$$/stat)
+    pzstd -d -q -c "${workdir}/rootfs.pzst" | cmp -s - "${loop}" ||
+        { echo "${handler}: the slot does not match the rootfs" >&2; exit 1; }
+    echo "${before} ${after}" | awk -v n="${handler}" -v s="${start}" -v e="${end}" \
+        -v size="${size}" -v hz="$(getconf CLK_TCK)" '
+        { printf "%-14s %10.2f %10.1f %10.2f %10.2f\n", n, e - s, size / 1048576 / (e - s),
+                 ($3 - $1) / hz, ($4 - $2) / hz }'
+done
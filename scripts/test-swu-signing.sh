@@ -0,0 +1,114 @@
+#!/bin/sh
+#
+# Sign a .swu with a key held in SoftHSM, standing in for the PKCS#11 token
+# of the release signer, and check that the signature and the artifact
+# hashes verify, and that a tampered sw-description or artifact does not.
+#
+# The signature is made like swupdate.bbclass makes it for CMS, only with
+# the key taken from the token through the OpenSSL pkcs11 engine. With
+# swupdate installed on the host the .swu is also checked with "swupdate -c".
+#
+# Needs softhsm2-util, pkcs11-tool (opensc), openssl with the pkcs11 engine
+# (libengine-pkcs11-openssl) and cpio.
+#
+# usage: scripts/test-swu-signing.sh
+
+set -e
+
+for tool in softhsm2-util pkcs11-tool openssl cpio; do
+    if ! command -v "${tool}" >/dev/null; then
+        echo "${tool} not found" >&2
+        exit 1
+    fi
+done
+
+module=""
+for path in /usr/lib/softhsm/libsofthsm2.so /usr/lib/*/softhsm/libsofthsm2.so /usr/lib64/pkcs11/libsofthsm2.so; do
+    [ -f "${path}" ] && module="${path}" && break
+done
+if [ -z "${module}" ]; then
+    echo "libsofthsm2.so not found" >&2
+    exit 1
+fi
+
+workdir="$(mktemp -d)"
+trap 'rm -rf "${workdir}"' EXIT
+cd "${workdir}"
+
+mkdir tokens
+echo "directories.tokendir = ${workdir}/tokens" >softhsm2.conf
+export SOFTHSM2_CONF="${workdir}/softhsm2.conf"
+export PKCS11_MODULE_PATH="${module}"
+
+pin=1234
+softhsm2-util --init-token --free --label skytrack --so-pin 5678 --pin "${pin}" >/dev/null
+pkcs11-tool --module "${module}" --token-label skytrack --login --pin "${pin}" \
+    --keypairgen --key-type rsa:2048 --label release --id 01 >/dev/null
+key="pkcs11:token=skytrack;object=release;type=private;pin-value=${pin}"
+
+openssl req -new -x509 -days 1 -subj "/CN=skytrack release" \
+    -engine pkcs11 -keyform engine -key "${key}" -out release-cert.pem 2>/dev/null
+
+dd if=/dev/urandom of=rootfs.ext4.zst bs=64k count=16 status=none
+cat >sw-description <<EOT
+software = {
+    version = "0.0.1";
+    full = {
+        copy2 = {
+            images: (
+                {
+                    filename = "rootfs.ext4.zst";
+                    type = "raw";
+                    device = "/dev/null";
+                    sha256 = "$(sha256sum rootfs.ext4.zst | cut -d' ' -f1)";
+                }
+            );
+        };
+    };
+}
+EOT
+
+sign() {
+    openssl cms -sign -in sw-description -out sw-description.sig -signer release-cert.pem \
+        -engine pkcs11 -keyform engine -inkey "${key}" -outform DER -nosmimecap -binary 2>/dev/null
+}
+
+verify() {
+    openssl cms -verify -in sw-description.sig -inform DER -content sw-description \
+        -CAfile release-cert.pem -purpose any -binary -out /dev/null 2>/dev/null &&
+        sha256sum --quiet --check <<EOT
+$(sed -n 's/.*sha256 = "\([0-9a-f]*\)".*/\1/p' sw-description)  rootfs.ext4.zst
+EOT
+}
+
+failures=0
+check() {
+    if [ "$1" = "$2" ]; then
+        echo "PASS: $3"
+    else
+        echo "FAIL: $3"
+        failures=$((failures + 1))
+    fi
+}
+
+sign
+verify >/dev/null 2>&1 && result=ok || result=rejected
+check "${result}" ok "token signature verifies"
+
+if command -v swupdate >/dev/null; then
+    printf '%s\n' sw-description sw-description.sig rootfs.ext4.zst | cpio -o -H crc --quiet >signed.swu
+    swupdate -c -k release-cert.pem -i signed.swu >/dev/null 2>&1 && result=ok || result=rejected
+    check "${result}" ok "swupdate accepts the signed .swu"
+fi
+
+cp sw-description sw-description.orig
+sed -i 's/0.0.1/0.0.2/' sw-description
+verify >/dev/null 2>&1 && result=ok || result=rejected
+check "${result}" rejected "tampered sw-description is rejected"
+
+mv sw-description.orig sw-description
+printf 'x' >>rootfs.ext4.zst
+verify >/dev/null 2>&1 && result=ok || result=rejected
+check "${result}" rejected "tampered artifact is rejected"
+
+[ "${failures}" -eq 0 ]
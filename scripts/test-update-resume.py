@@ -0,0 +1,120 @@
+#!/usr/bin/env python3
+#
+# Check that skytrack-update resumes interrupted downloads.
+#
+# Serves a random .swu from a local HTTP server that drops the connection
+# partway through the first few requests, runs skytrack-update in
+# download-only mode against it, and verifies the result and the number of
+# bytes sent: a resuming client fetches every byte exactly once.
+#
+# A second run starts from a .part of an older file at the same URL, which
+# must be thrown away rather than completed with bytes of the new one.
+#
+# A third run kills the client, and everything it started, partway through
+# its first transfer, as a reboot would, and checks that the next run
+# resumes that .part instead of downloading the whole file again.
+#
+# usage: scripts/test-update-resume.py [path/to/skytrack-update]
+
+import hashlib
+import os
+import signal
+import subprocess
+import sys
+import tempfile
+import time
+
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), "..", "meta-test", "lib"))
+from skytrack import rangeserver
+
+SIZE = 8 * 1024 * 1024
+DROP_AFTER = 1024 * 1024
+DROPS = 3
+
+
+def download(client, payload, stale=None, killed=False):
+    """Run the client against a dropping server, return (ok, handler).
+
+    With killed set, the first transfer stalls after DROP_AFTER bytes and the
+    client is killed there before it is run again.
+    """
+    if killed:
+        server, handler = rangeserver.serve({"/test.swu": payload}, 0, DROP_AFTER, stalls=1)
+    else:
+        server, handler = rangeserver.serve({"/test.swu": payload}, DROPS, DROP_AFTER)
+
+    with tempfile.TemporaryDirectory() as cache:
+        if stale:
+            with open(os.path.join(cache, "test.swu.part"), "wb") as f:
+                f.write(stale)
+            with open(os.path.join(cache, "test.swu.validator"), "w") as f:
+                f.write('"%s"\n' % hashlib.sha256(stale).hexdigest()[:16])
+
+        env = dict(os.environ, SKYTRACK_UPDATE_CACHE=cache, SKYTRACK_UPDATE_RETRY_DELAY="0",
+                   SKYTRACK_UPDATE_BACKGROUND="0")
+        url = "http://127.0.0.1:%d/test.swu" % server.server_address[1]
+        if killed:
+            part = os.path.join(cache, "test.swu.part")
+            client_run = subprocess.Popen(["sh", client, "-n", url], env=env,
+                                          start_new_session=True)
+            # curl keeps the tail of what it received buffered, so wait
+            # for the server side and then for the .part to stop growing
+            kept = -1
+            while handler.sent < DROP_AFTER or not os.path.exists(part) \
+                    or os.path.getsize(part) != kept:
+                kept = os.path.getsize(part) if os.path.exists(part) else -1
+                time.sleep(0.2)
+            os.killpg(client_run.pid, signal.SIGKILL)
+            client_run.wait()
+            handler.release.set()
+            # The bytes that did not make it into the .part are sent again
+            handler.lost = DROP_AFTER - kept
+        subprocess.run(["sh", client, "-n", url], env=env, check=True)
+
+        with open(os.path.join(cache, "test.swu"), "rb") as f:
+            ok = hashlib.sha256(f.read()).digest() == hashlib.sha256(payload).digest()
+
+    server.shutdown()
+    print("requests: %d, bytes sent: %d of %d" % (handler.requests, handler.sent, SIZE))
+    return ok, handler
+
+
+def main():
+    default = os.path.join(os.path.dirname(__file__), "..", "meta-test", "recipes-support",
+                           "skytrack-update", "skytrack-update", "skytrack-update")
+    client = sys.argv[1] if len(sys.argv) > 1 else default
+    failures = 0
+
+    ok, handler = download(client, os.urandom(SIZE))
+    if not ok:
+        print("FAIL: downloaded file differs")
+        failures += 1
+    elif handler.sent != SIZE:
+        print("FAIL: %d bytes sent, a resuming client needs exactly %d" % (handler.sent, SIZE))
+        failures += 1
+    else:
+        print("PASS: resumed")
+
+    ok, handler = download(client, os.urandom(SIZE), stale=os.urandom(2 * DROP_AFTER))
+    if not ok:
+        print("FAIL: stale .part of another file was resumed")
+        failures += 1
+    else:
+        print("PASS: stale .part discarded")
+
+    ok, handler = download(client, os.urandom(SIZE), killed=True)
+    if not ok:
+        print("FAIL: downloaded file differs after the client was killed")
+        failures += 1
+    elif handler.sent != SIZE + handler.lost:
+        print("FAIL: %d bytes sent after the client was killed, a resuming client needs %d"
+              % (handler.sent, SIZE + handler.lost))
+        failures += 1
+    else:
+        print("PASS: resumed after the client was killed")
+
+    return 1 if failures else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
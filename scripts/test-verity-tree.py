@@ -0,0 +1,114 @@
+#!/usr/bin/env python3
+#
+# Check the parallel dm-verity hash tree of meta-test/lib/skytrack/verity.py.
+#
+# For images whose tree has one, two and three levels of hash blocks, the tree
+# built by several processes has to be byte for byte the one built by a
+# single process, and walking it from the superblock the way dm-verity
+# reads it has to lead back from every data block to the root hash. With
+# veritysetup on the host the image is also checked with "veritysetup
+# verify".
+#
+# usage: scripts/test-verity-tree.py
+
+import hashlib
+import os
+import shutil
+import struct
+import subprocess
+import sys
+import tempfile
+import uuid
+
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), "..", "meta-test", "lib"))
+from skytrack import verity
+
+DATA_BLOCK_SIZE = 1024
+HASH_BLOCK_SIZE = 4096
+SALT = bytes(range(32))
+UUID = uuid.UUID("12345678-1234-5678-1234-567812345678")
+
+
+def walk(path, hash_offset, root):
+    """Check the tree against the data and the root hash, as dm-verity does."""
+    with open(path, "rb") as f:
+        image = f.read()
+    sb = struct.unpack_from("<8sII16s32sIIQH", image, hash_offset)
+    signature, _, hash_type, _, algorithm, data_block_size, hash_block_size, data_blocks, salt_size = sb
+    salt = image[hash_offset + 88:hash_offset + 88 + salt_size]
+    if signature != b"verity\0\0" or hash_type != 1 or algorithm.rstrip(b"\0") != b"sha256":
+        return "bad superblock"
+
+    digest = lambda data: hashlib.sha256(salt + data).digest()
+    per_block = hash_block_size // 32
+    # Blocks per level, bottom up, and where each level starts, top down
+    sizes = []
+    count = data_blocks
+    while count > 1:
+        count = -(-count // per_block)
+        sizes.append(count)
+    starts = []
+    position = hash_offset + hash_block_size
+    for size in reversed(sizes):
+        starts.insert(0, position)
+        position += size * hash_block_size
+
+    for block in range(data_blocks):
+        expected = digest(image[block * data_block_size:(block + 1) * data_block_size])
+        index = block
+        for level, start in enumerate(starts):
+            hash_block = index // per_block
+            at = start + hash_block * hash_block_size + (index % per_block) * 32
+            if image[at:at + 32] != expected:
+                return "data block %d: level %d digest differs" % (block, level)
+            block_at = start + hash_block * hash_block_size
+            expected = digest(image[block_at:block_at + hash_block_size])
+            index = hash_block
+        if expected != root:
+            return "data block %d does not lead to the root hash" % block
+    return None
+
+
+def main():
+    failures = 0
+    veritysetup = shutil.which("veritysetup")
+    with tempfile.TemporaryDirectory() as workdir:
+        for blocks in (1, 100, 20000):
+            data = os.urandom(blocks * DATA_BLOCK_SIZE)
+            # The data has to end on a hash block for the superblock
+            data = data.ljust(-(-len(data) // HASH_BLOCK_SIZE) * HASH_BLOCK_SIZE, b"\0")
+            images = {}
+            for jobs in (1, 4):
+                path = os.path.join(workdir, "%d-%d.img" % (blocks, jobs))
+                with open(path, "wb") as f:
+                    f.write(data)
+                params = dict(verity.build(path, len(data), DATA_BLOCK_SIZE, HASH_BLOCK_SIZE,
+                                           SALT, UUID, jobs))
+                with open(path, "rb") as f:
+                    images[jobs] = f.read()
+
+            what = "%d data blocks" % (len(data) // DATA_BLOCK_SIZE)
+            error = None
+            if images[1] != images[4]:
+                error = "4 processes built a different tree than 1"
+            else:
+                error = walk(path, len(data), bytes.fromhex(params["Root hash"]))
+            if not error and veritysetup:
+                result = subprocess.run([veritysetup, "verify", "--hash-offset=%d" % len(data),
+                                         path, path, params["Root hash"]],
+                                        stdout=subprocess.PIPE, stderr=subprocess.STDOUT, text=True)
+                if result.returncode:
+                    error = "veritysetup verify failed: %s" % result.stdout.strip()
+            if error:
+                print("FAIL: %s: %s" % (what, error))
+                failures += 1
+            else:
+                print("PASS: %s" % what)
+
+    if not veritysetup:
+        print("veritysetup not found, the trees were not checked with it")
+    return 1 if failures else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
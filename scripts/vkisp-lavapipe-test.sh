@@ -0,0 +1,24 @@
+#!/bin/sh
+#
+# Build skytrack-vkisp for the host and run its test on Mesa lavapipe, the
+# software Vulkan driver, so the compute shaders are checked against the
+# CPU reference without a GPU. Needs cmake, a C++ compiler, the Vulkan
+# headers and loader, glslangValidator and the Mesa Vulkan drivers.
+#
+# usage: scripts/vkisp-lavapipe-test.sh [build-dir]
+
+set -e
+
+src="$(dirname "$0")/../meta-skytrack/recipes-graphics/skytrack-vkisp/skytrack-vkisp"
+build="${1:-$(mktemp -d)}"
+
+icd=$(ls /usr/share/vulkan/icd.d/lvp_icd*.json 2>/dev/null | head -n 1)
+if [ -z "${icd}" ]; then
+    echo "lavapipe not found, install the Mesa Vulkan drivers" >&2
+    exit 1
+fi
+
+cmake -S "${src}" -B "${build}" -DCMAKE_BUILD_TYPE=Release
+cmake --build "${build}" -j"$(nproc)"
+VK_ICD_FILENAMES="${icd}" SKYTRACK_VKISP_DEVICE=llvmpipe "${build}/vkisp-test"
+VK_ICD_FILENAMES="${icd}" SKYTRACK_VKISP_DEVICE=llvmpipe "${build}/vkisp-bench" 1920 1080 4 20